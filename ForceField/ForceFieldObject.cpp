@@ -7,6 +7,8 @@
 #include "../../../OverlordEngine/Scenegraph/GameScene.h"
 
 #include "../Managers/GameDirector.h"
+#include "../Managers/EnemyManager.h"
+#include "../Enemies/Enemy.h"
 
 ForceFieldObject::ForceFieldObject(GameDirector* pOwnerDirector, PhysicsGroup groupID, 
 								   const NxVec3& sizeShape, const NxVec3& position):
@@ -69,6 +71,32 @@ void ForceFieldObject::Update(GameContext& context)
 {
 	//Hold lifetime
 	m_fCurrentLifeTime += context.GameTime.ElapsedSeconds();
+
+	//Walking enemies only move their ragdoll actors when asked, so ask it for
+	//every enemy that overlaps our box
+	if(m_pOwnerDirector == nullptr || m_pOwnerDirector->GetEnemyManager() == nullptr)
+		return;
+
+	//Margin for the size of an enemy (controller radius and half its height)
+	const NxVec3 margin(1.5f, 2.5f, 1.5f);
+	const vector<Enemy*>& enemies = m_pOwnerDirector->GetEnemyManager()->GetActiveEnemies();
+	for(auto enemy : enemies)
+	{
+		if(enemy == nullptr)
+			continue;
+
+		D3DXVECTOR3 position = enemy->GetPositionEnemy();
+		if(abs(position.x - m_Position.x) <= m_SizeShape.x + margin.x
+			&& abs(position.y - m_Position.y) <= m_SizeShape.y + margin.y
+			&& abs(position.z - m_Position.z) <= m_SizeShape.z + margin.z)
+		{
+			//A baked corpse needs its actors back before the field can push it,
+			//and the ragdoll has to be in the scene of the field
+			enemy->KeepRagdollInMainScene();
+			enemy->WakeRagdoll();
+			enemy->RequestRagdollSync();
+		}
+	}
 }
 
 bool ForceFieldObject::ReachedEndLifeTime() const
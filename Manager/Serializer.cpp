@@ -16,6 +16,8 @@
 #include "ForceFieldManager.h"
 #include "../ForceField/ForceFieldObject.h"
 #include "../Ragdolls/RagdollHelper.h"
+#include "../Ragdolls/RagdollLayout.h"
+#include "../Ragdolls/RagdollCommandBuffer.h"
 #include "../Targets/Target.h"
 #include "../../../OverlordEngine/Managers/PhysicsManager.h"
 
@@ -520,14 +522,16 @@ bool Serializer::SerializeActiveEnemies(tstringstream& ss, int depth)
 			//----------------------------------------
 			// PhysX Information - IF DEATH OR PARALYZED
 			//----------------------------------------
-			//Get all actors
-			vector<NxActor*> vEnemyRagdollActors = enemy->GetRagdollActors();
+			//Move the actors to the current animation if they only follow it on demand
+			enemy->SyncRagdollPoses();
 
 			//PhysXStates Tag Start
 			for(int i=0; i < depth+1; ++i)
 				ss << _T("\t");
 			ss << _T("<PhysXStates amountRagdollActors=\"");
-			ss << vEnemyRagdollActors.size();
+			ss << enemy->GetAmountOfRagdollActors();
+			ss << _T("\" ragdollLod=\"");
+			ss << enemy->GetRagdollLod();
 			ss << _T("\">\n");
 
 			//Add Controller Position
@@ -546,11 +550,17 @@ bool Serializer::SerializeActiveEnemies(tstringstream& ss, int depth)
 			if(enemy->GetEnemyState() == GameHelper::EnemyState::Dead
 				|| enemy->GetEnemyState() == GameHelper::EnemyState::Paralyzed)
 			{
-				//Serialize actors
-				for(auto actor : vEnemyRagdollActors)
+				//Serialize actors. Without actors (baked, or no skeleton yet) the poses come from the pose buffer.
+				//Loading restores as many actors as there are, a short list doesn't break the save.
+				for(UINT slot=0; slot < enemy->GetAmountOfRagdollActors(); ++slot)
 				{
-					if(actor == nullptr)
-						return false;
+					D3DXMATRIX matGlobalPose;
+					NxVec3 linVel;
+					if(!enemy->GetRagdollActorPose(slot, matGlobalPose, linVel))
+					{
+						Logger::Log(_T("Serializer: Ragdoll actor without pose, the rest of the enemy's ragdoll is not saved"), LogLevel::Warning);
+						break;
+					}
 
 					//Actor Tag Start
 					for(int i=0; i < depth+2; ++i)
@@ -558,11 +568,6 @@ bool Serializer::SerializeActiveEnemies(tstringstream& ss, int depth)
 					ss << _T("<RagdollActor>\n");
 
 					//Actor POSE tag
-					D3DXMATRIX matGlobalPose;
-					D3DXMatrixIdentity(&matGlobalPose);
-					PhysicsManager::GetInstance()->NMatToDMat(matGlobalPose, 
-						actor->getGlobalPose());
-
 					for(int i=0; i < depth+3; ++i)
 						ss << _T("\t");
 					ss << _T("<GlobalPose _11=\"");
@@ -600,7 +605,6 @@ bool Serializer::SerializeActiveEnemies(tstringstream& ss, int depth)
 					ss << _T("\"/>\n");
 
 					//Actor LINVEL tag
-					NxVec3 linVel = actor->getLinearVelocity();
 					for(int i=0; i < depth+3; ++i)
 						ss << _T("\t");
 					ss << _T("<LinearVelocity x=\"");
@@ -848,7 +852,7 @@ bool Serializer::LoadEnemies(pugi::xml_node root, RollBackContainer& rollbackCon
 			switch(enemyType)
 			{
 			case 0:
-				succeeded = LoadEnemyType0(physxState, rollbackContainer, rbEnemy, 11); //Load Enemy 0, which uses 11 ragdollactors
+				succeeded = LoadEnemyType0(physxState, rollbackContainer, rbEnemy, 11); //Load Enemy 0, which uses 11 ragdollactors (full LOD tier)
 				if(succeeded == false) //If something failed return false
 					return false;
 				break;
@@ -878,6 +882,16 @@ bool Serializer::LoadEnemyType0(pugi::xml_node physXStatesEnemy, RollBackContain
 	//Type is important because our enemy creates actors for it's ragdoll. We want to fill
 	//in these actors with our savegame information.
 	//We must be sure we've got the right type and same amount of actors!!!
+	//Saves made before the LOD tiers have no ragdollLod, they used the full ragdoll
+	int ragdollLod = physXStatesEnemy.attribute(_T("ragdollLod")).as_int();
+	if(ragdollLod < 0 || ragdollLod >= RagdollLod::LodCount)
+		return false;
+	rbEnemy.ragdollLod = static_cast<RagdollLod>(ragdollLod);
+	if(rbEnemy.ragdollLod == RagdollLod::LodReduced)
+		amountOfRagdollActors = HumanoidReducedLayout::AmountOfBones;
+	else if(rbEnemy.ragdollLod == RagdollLod::LodMinimal)
+		amountOfRagdollActors = HumanoidMinimalLayout::AmountOfBones;
+
 	rbEnemy.amountOfRagdollActors = physXStatesEnemy.attribute(_T("amountRagdollActors")).as_int();
 	if(rbEnemy.amountOfRagdollActors != amountOfRagdollActors)
 		return false;
@@ -1072,13 +1086,16 @@ bool Serializer::LoadSaveGameInMemory(const RollBackContainer& rollbackContainer
 		if(memEnemy->GetEnemyState() == GameHelper::EnemyState::Dead)
 			pEnemyManager->FlagEnemyForRemoval(memEnemy);
 
-		//Get the actors
-		vector<NxActor*> vEnemyRagdollActors = memEnemy->GetRagdollActors();
+		//Set ragdoll LOD tier and state. The tier can only change while the ragdoll is animated, so
+		//make sure it is first. All right away, not through the transition queue, we need the actors below.
+		memEnemy->SetRagdollState(RagdollState::LeechState, true);
+		memEnemy->SetRagdollLod(enemy.ragdollLod);
+		memEnemy->SetRagdollState(enemy.ragdollState, true);
 
-		//Amount of actors allready checked before this stage. Else rollback can't be done our way!
+		//Get the actors, after setting the state: a walking enemy only gets its skeleton in SeedState
+		ArrayView<NxActor* const> vEnemyRagdollActors = memEnemy->GetRagdollActors();
 
-		//Set ragdoll state
-		memEnemy->SetRagdollState(enemy.ragdollState);
+		//Amount of actors allready checked before this stage. Else rollback can't be done our way!
 
 		//Set the controller of the enemy
 		memEnemy->SetPositionEnemy(enemy.positionController);
@@ -1087,18 +1104,19 @@ bool Serializer::LoadSaveGameInMemory(const RollBackContainer& rollbackContainer
 		//Else there won't be data in the file. See the LoadEnemy0 for the check!
 		if(memEnemy->GetRagdollState() == RagdollState::SeedState)
 		{
-			//Counter
-			UINT actorID = 0;
+			//A save of another LOD tier or skeleton can have another amount of actors, restore what matches
+			UINT amountActors = min(vEnemyRagdollActors.size(), (UINT)enemy.ragdollActorTransforms.size());
+			amountActors = min(amountActors, (UINT)enemy.ragdollActorLinVel.size());
 
-			for(auto actor : vEnemyRagdollActors)
+			for(UINT actorID = 0; actorID < amountActors; ++actorID)
 			{
+				NxActor* actor = vEnemyRagdollActors[actorID];
 				if(actor != nullptr)
 				{
-					actor->setGlobalPose(enemy.ragdollActorTransforms.at(actorID));
-					actor->setLinearVelocity(enemy.ragdollActorLinVel.at(actorID));
+					//After the state change above, which may still be waiting in the command buffer
+					RagdollCommandBuffer::GetInstance()->SetGlobalPose(actor, enemy.ragdollActorTransforms[actorID]);
+					RagdollCommandBuffer::GetInstance()->SetLinearVelocity(actor, enemy.ragdollActorLinVel[actorID]);
 				}
-
-				++actorID;
 			}
 		}
 	}
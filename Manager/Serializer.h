@@ -22,7 +22,7 @@ class Enemy;
 struct RollBackEnemy final
 {
 	RollBackEnemy(void):enemyState(GameHelper::EnemyState::Walking), ragdollState(RagdollState::LeechState),
-		amountOfRagdollActors(0), positionController(D3DXVECTOR3(0,0,0))
+		ragdollLod(RagdollLod::LodFull), amountOfRagdollActors(0), positionController(D3DXVECTOR3(0,0,0))
 	{}
 
 	~RollBackEnemy(void)
@@ -33,6 +33,7 @@ struct RollBackEnemy final
 
 	GameHelper::EnemyState enemyState;
 	RagdollState ragdollState;
+	RagdollLod ragdollLod;
 	UINT amountOfRagdollActors;
 	D3DXVECTOR3 positionController;
 	vector<NxMat34> ragdollActorTransforms;
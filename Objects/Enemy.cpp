@@ -12,6 +12,11 @@
 #include "../../SZS_Materials/SkinnedMaterial.h"
 #include "../Managers/EnemyManager.h"
 #include "../Ragdolls/PhysicsAnimator.h"
+#include "../Ragdolls/RagdollCommandBuffer.h"
+#include "../Ragdolls/RagdollLod.h"
+#include "../Ragdolls/RagdollPosePipeline.h"
+#include "../Ragdolls/RagdollProxy.h"
+#include "../Ragdolls/RagdollSceneShards.h"
 #include "../Targets/Target.h"
 
 #include "../ErrorHandling/ErrorHandles.h"
@@ -32,10 +37,12 @@ Enemy::Enemy(EnemyManager* pOwnerEnemyManager, float destroyInterval):
 	m_fGravityVelocity(0.0f), m_fTerminalVelocity(0.5f),
 	m_fWalkSpeed(7.0f), m_fMaximumWalkingSpeed(4.0f),
 	m_Velocity(D3DXVECTOR3(0,0,0)),
+	m_bRagdollSettled(false), m_bKeepCorpseCollider(false),
 	m_fCurrentRecoverTime(0.0f), m_fTotalRecoverTime(4.0f),
 	m_bFlaggedToRemoveUnderY(false),
 	m_bIsPickable(true), m_fMaximumTimeUnpickable(5.0f), m_fCurrentTimeUnpickable(0.0f),
-	m_bIsShowcase(true)
+	m_bIsShowcase(true),
+	m_fContactReportThreshold(NX_MAX_REAL), m_iContactReportFlags(0)
 {
 	 m_fGravityAcceleration = m_fGravity/m_fGravityAccelerationTime;
 	 m_fHeightOffset = -(m_fHeight/2 + 0.5f);
@@ -43,6 +50,10 @@ Enemy::Enemy(EnemyManager* pOwnerEnemyManager, float destroyInterval):
 
 Enemy::~Enemy(void)
 {
+	//The animator lives a bit longer than we do (it goes with our components)
+	if(m_pModelComponent != nullptr && m_pModelComponent->GetPhysxAnimator() != nullptr)
+		m_pModelComponent->GetPhysxAnimator()->SetSettleListener(nullptr);
+
 	SafeDelete(m_pSkinnedMaterial);
 	SafeDelete(m_pSkinnedShadowGenerationMaterial);
 }
@@ -79,6 +90,14 @@ void Enemy::Initialize()
 
 	//Base Init
 	GameObject::Initialize();
+
+	//While walking, one proxy capsule is enough. The full ragdoll is taken from the pool when we get knocked down.
+	PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
+	if(physxAnimator != nullptr)
+	{
+		physxAnimator->SetLeechProxyEnabled(true);
+		physxAnimator->SetSettleListener(this);
+	}
 }
 
 void Enemy::Update(GameContext& context)
@@ -101,6 +120,15 @@ void Enemy::Update(GameContext& context)
 	{
 		m_eCurrentState = GameHelper::EnemyState::Paralyzed;
 	}
+
+	//---------------------------------------------
+	//Physics LOD
+	//---------------------------------------------
+	//Before the ragdoll state is set, so an enemy that gets linked while walking is knocked down with the full ragdoll
+	UpdateRagdollLod(context);
+	//The player grabbed a ragdoll the budget baked, it needs its actors back
+	if(m_eCurrentInteractState == GameHelper::EnemyInteractState::Linked)
+		WakeRagdoll();
 	
 	//---------------------------------------------
 	//Check our ai states
@@ -129,21 +157,23 @@ void Enemy::Update(GameContext& context)
 		//Set the ragdoll state if needed
 		SetRagdollState(RagdollState::SeedState);
 
-		//Position controller
-		D3DXVECTOR3 position = this->GetPositionRootBone();
-		position.y = 1.0f;
-		position.z = 0;
-		m_pControllerComponent->Translate(position);
+		//Position controller. A ragdoll baked by the budget has no root actor, it doesn't move anyway.
+		//Neither does one still waiting for its turn in the transition queue.
+		if(GetRagdollState() == RagdollState::SeedState && !IsRagdollBaked())
+		{
+			D3DXVECTOR3 position = this->GetPositionRootBone();
+			position.y = 1.0f;
+			position.z = 0;
+			m_pControllerComponent->Translate(position);
+		}
 
 		//If enemy is paralyzed and not linked check if he hasn't moved
 		//for x amount of seconds. If not let him recover
 		if(m_eCurrentInteractState != GameHelper::EnemyInteractState::Linked)
 		{
-			//Countdown
-			if(IsEnemyMoving() == false)
+			//Countdown while the ragdoll rests, OnRagdollWoken resets it
+			if(m_bRagdollSettled)
 				m_fCurrentRecoverTime += context.GameTime.ElapsedSeconds();
-			else
-				m_fCurrentRecoverTime = 0.0f;
 
 			//If needs to recover, recover
 			if(m_fCurrentRecoverTime >= m_fTotalRecoverTime)
@@ -166,11 +196,15 @@ void Enemy::Update(GameContext& context)
 		//Set the ragdoll state if needed
 		SetRagdollState(RagdollState::SeedState);
 
-		//Position controller
-		D3DXVECTOR3 position = this->GetPositionRootBone();
-		position.y = 1.0f;
-		position.z = 0;
-		m_pControllerComponent->Translate(position);
+		//Position controller. A baked corpse doesn't move anymore and has no root actor to follow,
+		//a ragdoll waiting in the transition queue has none yet
+		if(GetRagdollState() == RagdollState::SeedState && !IsRagdollBaked())
+		{
+			D3DXVECTOR3 position = this->GetPositionRootBone();
+			position.y = 1.0f;
+			position.z = 0;
+			m_pControllerComponent->Translate(position);
+		}
 	}
 	else if(m_eCurrentState == GameHelper::EnemyState::Recovering)
 	{
@@ -339,62 +373,102 @@ bool Enemy::HasContactWithFloor(D3DXVECTOR3 position) const
 
 bool Enemy::IsEnemyMoving() const
 {
-	if(m_pModelComponent == nullptr)
-		return false;
+	//The ragdoll tells us when it settles or wakes up, no need to look at the actors
+	return GetRagdollState() == RagdollState::SeedState && !m_bRagdollSettled;
+}
 
-	//Check if any of the actors is moving - RAGDOLL COMPONENT ACTORS
-	float comparisonValue = 4.0f;
+void Enemy::OnRagdollSettled(PhysicsAnimator* pAnimator)
+{
+	m_bRagdollSettled = true;
 
-	vector<NxActor*> vActorsSkeleton;
-	vActorsSkeleton = m_pModelComponent->GetPhysxSkeleton()->GetBoneActors();
+	//Nobody gets up from here, the corpse only needs its pose
+	if(m_eCurrentState == GameHelper::EnemyState::Dead)
+		BakeRagdoll();
+}
 
-	for(auto actor : vActorsSkeleton)
+void Enemy::BakeRagdoll()
+{
+	if(m_pModelComponent != nullptr)
 	{
-		float x, y, z;
-		x = actor->getLinearVelocity().x;
-		y = actor->getLinearVelocity().y;
-		z = actor->getLinearVelocity().z;
+		PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
+		if(physxAnimator != nullptr)
+			physxAnimator->Bake(m_bKeepCorpseCollider);
+	}
+}
+
+void Enemy::WakeRagdoll()
+{
+	if(m_pModelComponent == nullptr)
+		return;
+
+	PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
+	if(physxAnimator == nullptr || !physxAnimator->IsBaked())
+		return;
 
-		if(x > comparisonValue || y > comparisonValue || z > comparisonValue)
-			return true;
+	physxAnimator->Unbake();
+	m_bRagdollSettled = false;
+
+	//The skeleton comes fresh from the pool, give it our contact report settings
+	SetContactReportThreshold(m_fContactReportThreshold);
+	SetContactReportFlags(m_iContactReportFlags);
+}
+
+bool Enemy::IsRagdollBaked() const
+{
+	if(m_pModelComponent != nullptr)
+	{
+		PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
+		if(physxAnimator != nullptr)
+			return physxAnimator->IsBaked();
 	}
-	
 	return false;
 }
 
+void Enemy::OnRagdollWoken(PhysicsAnimator* pAnimator)
+{
+	//Hit again, start counting from zero once it rests
+	m_bRagdollSettled = false;
+	m_fCurrentRecoverTime = 0.0f;
+}
+
 void Enemy::SetContactReportThreshold(float value)
 {
+	//Remembered for the skeleton we only get in SeedState (see SetRagdollState)
+	m_fContactReportThreshold = value;
 	if(m_pModelComponent == nullptr)
 		return;
 
-	vector<NxActor*> vActorsSkeleton;
-	vActorsSkeleton = m_pModelComponent->GetPhysxSkeleton()->GetBoneActors();
-
-	for(auto actor : vActorsSkeleton)
+	//Through the command buffer, the LOD or a hit can change it while PhysX simulates
+	const PhysxSkeleton* pSkeleton = m_pModelComponent->GetPhysxSkeleton();
+	for(auto actor : GetRagdollActors())
 	{
-		actor->setContactReportThreshold(value);
+		RagdollCommandBuffer::GetInstance()->SetContactReportThreshold(actor, value, pSkeleton);
 	}
 }
 
 void Enemy::SetContactReportFlags(NxU32 flags)
 {
+	m_iContactReportFlags = flags;
 	if(m_pModelComponent == nullptr)
 		return;
 
-	vector<NxActor*> vActorsSkeleton;
-	vActorsSkeleton = m_pModelComponent->GetPhysxSkeleton()->GetBoneActors();
+	//The lowest LOD tiers don't report contacts at all
+	PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
+	if(physxAnimator != nullptr && !RagdollLodPolicy::GetSettings(physxAnimator->GetLod()).contactReports)
+		flags = 0;
 
-	for(auto actor : vActorsSkeleton)
+	const PhysxSkeleton* pSkeleton = m_pModelComponent->GetPhysxSkeleton();
+	for(auto actor : GetRagdollActors())
 	{
-		actor->setContactReportFlags(flags);
+		RagdollCommandBuffer::GetInstance()->SetContactReportFlags(actor, flags, pSkeleton);
 	}
 }
 
-vector<NxActor*> Enemy::GetRagdollActors() const
+ArrayView<NxActor* const> Enemy::GetRagdollActors() const
 {
-	vector<NxActor*> vRagdollActors;
+	ArrayView<NxActor* const> vRagdollActors;
 
-	if(m_pModelComponent != nullptr)
+	if(m_pModelComponent != nullptr && m_pModelComponent->GetPhysxSkeleton() != nullptr)
 	{
 		vRagdollActors = m_pModelComponent->GetPhysxSkeleton()->GetBoneActors();
 	}
@@ -402,13 +476,178 @@ vector<NxActor*> Enemy::GetRagdollActors() const
 	return vRagdollActors;
 }
 
-void Enemy::SetRagdollState(RagdollState state)
+UINT Enemy::GetAmountOfRagdollActors() const
+{
+	if(m_pModelComponent != nullptr)
+	{
+		PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
+		if(physxAnimator != nullptr && physxAnimator->GetDefinition() != nullptr)
+			return physxAnimator->GetDefinition()->GetAmountOfBones();
+	}
+	return GetRagdollActors().size();
+}
+
+bool Enemy::GetRagdollActorPose(UINT slot, D3DXMATRIX& matWorldPose, NxVec3& linearVelocity) const
+{
+	if(m_pModelComponent != nullptr)
+	{
+		PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
+		if(physxAnimator != nullptr)
+			return physxAnimator->GetActorPose(slot, matWorldPose, linearVelocity);
+	}
+	return false;
+}
+
+void Enemy::SetRagdollState(RagdollState state, bool immediate)
+{
+	if(m_pModelComponent != nullptr)
+	{
+		PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
+		if(physxAnimator == nullptr)
+			return;
+		if(physxAnimator->GetRequestedState() == state
+			&& (!immediate || physxAnimator->GetCurrentState() == state))
+			return;
+
+		//Queued, see OnRagdollStateChanged for when it happens
+		physxAnimator->SetCurrentState(state, immediate);
+		m_bRagdollSettled = false;
+	}
+}
+
+void Enemy::OnRagdollStateChanged(PhysicsAnimator* pAnimator, RagdollState state)
+{
+	//The skeleton can come fresh from the pool, give it our contact report settings
+	if(state == RagdollState::SeedState)
+	{
+		SetContactReportThreshold(m_fContactReportThreshold);
+		SetContactReportFlags(m_iContactReportFlags);
+	}
+}
+
+void Enemy::OnRagdollMigrated(PhysicsAnimator* pAnimator)
+{
+	//New actors from the pool of the other scene
+	SetContactReportThreshold(m_fContactReportThreshold);
+	SetContactReportFlags(m_iContactReportFlags);
+}
+
+void Enemy::KeepRagdollInMainScene()
+{
+	if(m_pModelComponent != nullptr)
+	{
+		PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
+		if(physxAnimator != nullptr)
+			RagdollSceneShards::GetInstance()->RequestMainScene(physxAnimator);
+	}
+}
+
+bool Enemy::ActivateRagdollRegion(const tstring& rootBoneName, float duration)
+{
+	if(m_pModelComponent == nullptr || GetRagdollState() != RagdollState::LeechState)
+		return false;
+
+	PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
+	if(physxAnimator == nullptr)
+		return false;
+
+	//The tier may not have a body for this bone, then nothing reacts
+	if(!physxAnimator->ActivateRegion(BoneNameTable::GetInstance()->Find(rootBoneName), duration))
+		return false;
+
+	//New actors of the limb can come fresh from the pool
+	SetContactReportThreshold(m_fContactReportThreshold);
+	SetContactReportFlags(m_iContactReportFlags);
+	return true;
+}
+
+bool Enemy::ActivateRagdollRegion(NxActor* pHitActor, const D3DXVECTOR3& hitPoint, float duration)
+{
+	if(m_pModelComponent == nullptr || pHitActor == nullptr || GetRagdollState() != RagdollState::LeechState)
+		return false;
+
+	PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
+	if(physxAnimator == nullptr)
+		return false;
+
+	//Only our own actors, their slot is their place in the skeleton
+	ArrayView<NxActor* const> vRagdollActors = GetRagdollActors();
+	for(UINT slot=0; slot < vRagdollActors.size(); ++slot)
+	{
+		if(vRagdollActors[slot] == pHitActor)
+			return physxAnimator->ActivateRegion(slot, duration);
+	}
+
+	//Our proxy, it stands in for all bodies: take the one nearest to the hit
+	if(pHitActor->getNbShapes() == 0)
+		return false;
+	RagdollProxy* pProxy = RagdollProxy::GetProxyOfShape(pHitActor->getShapes()[0]);
+	if(pProxy == nullptr || pProxy->GetOwnerPhysxAnimator() != physxAnimator)
+		return false;
+
+	int slot = physxAnimator->FindNearestSlot(hitPoint);
+	if(slot < 0)
+		return false;
+	return physxAnimator->ActivateRegion((UINT)slot, duration);
+}
+
+void Enemy::SetRagdollLod(RagdollLod lod)
+{
+	if(m_pModelComponent != nullptr)
+	{
+		PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
+		if(physxAnimator != nullptr)
+			physxAnimator->SetLod(lod);
+	}
+}
+
+RagdollLod Enemy::GetRagdollLod() const
+{
+	if(m_pModelComponent != nullptr)
+	{
+		PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
+		if(physxAnimator != nullptr)
+			return physxAnimator->GetLod();
+	}
+	return RagdollLod::LodFull;
+}
+
+void Enemy::UpdateRagdollLod(GameContext& context)
+{
+	if(context.pCamera == nullptr)
+		return;
+
+	D3DXVECTOR3 toCamera = context.pCamera->GetTransform()->GetWorldPosition()
+		- this->GetComponent<TransformComponent>()->GetWorldPosition();
+	float distance = D3DXVec3Length(&toCamera);
+
+	//The enemy the player is holding and the showcase always get the full ragdoll
+	bool isImportant = m_bIsShowcase || m_eCurrentInteractState == GameHelper::EnemyInteractState::Linked;
+	SetRagdollLod(RagdollLodPolicy::Select(distance, isImportant, GetRagdollLod()));
+
+	//The same numbers rank us for the RagdollBudget
+	PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
+	if(physxAnimator != nullptr)
+		physxAnimator->SetBudgetPriority(distance, isImportant);
+}
+
+void Enemy::RequestRagdollSync()
+{
+	if(m_pModelComponent != nullptr)
+	{
+		PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
+		if(physxAnimator != nullptr)
+			physxAnimator->RequestLeechSync();
+	}
+}
+
+void Enemy::SyncRagdollPoses()
 {
 	if(m_pModelComponent != nullptr)
 	{
 		PhysicsAnimator* physxAnimator = m_pModelComponent->GetPhysxAnimator();
 		if(physxAnimator != nullptr)
-			physxAnimator->SetCurrentState(state);
+			physxAnimator->SyncLeechPoses();
 	}
 }
 
@@ -438,7 +677,13 @@ D3DXVECTOR3 Enemy::GetPositionRootBone() const
 	if(pSkeleton != nullptr)
 		pRootBoneActor = pSkeleton->GetRootBoneActor();
 
-	if(pRootBoneActor != nullptr)
+	//Pipelined, PhysX may be simulating: the root as captured at the last fetchResults
+	if(pRootBoneActor != nullptr && RagdollPosePipeline::GetInstance()->IsEnabled())
+	{
+		const D3DXMATRIX& matRootPose = pSkeleton->GetCapturedActorPose(0);
+		rootBonePosition = D3DXVECTOR3(matRootPose._41, matRootPose._42, matRootPose._43);
+	}
+	else if(pRootBoneActor != nullptr)
 	{
 		rootBonePosition.x = pRootBoneActor->getGlobalPosition().x;
 		rootBonePosition.y = pRootBoneActor->getGlobalPosition().y;
@@ -12,13 +12,15 @@
 
 #include "../GameHelper.h"
 #include "../Ragdolls/RagdollHelper.h"
+#include "../Ragdolls/ArrayView.h"
+#include "../Ragdolls/PhysicsAnimator.h"
 
 class SkinnedShadowGenerationMaterial;
 class SkinnedMaterial;
 class EnemyManager;
 class Target;
 
-class Enemy final :public GameObject
+class Enemy final :public GameObject, public RagdollSettleListener
 {
 public:
 	Enemy(EnemyManager* pOwnerEnemyManager, float destroyInterval = 1.0f);
@@ -48,20 +50,55 @@ public:
 	//Gets the position of our enemy (charactercontroller)
 	D3DXVECTOR3 GetPositionEnemy() const;
 
-	//Setup ContactReport trigger
+	//Setup ContactReport trigger, also used for the ragdoll actors we get later on
 	void SetContactReportThreshold(float value);
 	void SetContactReportFlags(NxU32 flags);
 
-	//Ragdoll Actors
-	vector<NxActor*> GetRagdollActors() const;
+	//Ragdoll Actors (view on the actors owned by the ragdoll skeleton).
+	//Empty while walking with the proxy, see GetAmountOfRagdollActors.
+	ArrayView<NxActor* const> GetRagdollActors() const;
+	//Amount of actors of the full ragdoll, also when it isn't built yet
+	UINT GetAmountOfRagdollActors() const;
+	//World pose and velocity of the ragdoll actor in this slot, also for a baked ragdoll
+	bool GetRagdollActorPose(UINT slot, D3DXMATRIX& matWorldPose, NxVec3& linearVelocity) const;
 	void SetRagdollActors();
 
-	//Ragdoll States
-	void SetRagdollState(RagdollState state);
+	//Ragdoll States. The change can be spread over frames by the RagdollTransitionQueue (when enabled),
+	//GetRagdollState returns the state the ragdoll is in right now.
+	void SetRagdollState(RagdollState state, bool immediate = false);
 	const RagdollState GetRagdollState() const;
-
-	//Checking if Enemy Ragdoll Actors are moving
+	//While walking, the ragdoll actors only follow the animation on demand.
+	//Request keeps them in sync for this frame, Sync moves them right now (before picking or saving).
+	void RequestRagdollSync();
+	void SyncRagdollPoses();
+	//Force fields only live in the main PhysX scene. Ask every frame the ragdoll has to stay
+	//there (see RagdollSceneShards), it moves over in the next shard update.
+	void KeepRagdollInMainScene();
+
+	//Hit reaction while walking: only the limb starting at this bone (or ragdoll actor) goes
+	//dynamic for a while, the rest keeps walking. Push the actors of the limb after this.
+	//A hit on the leech proxy starts the limb of the body nearest to the hit point.
+	bool ActivateRagdollRegion(const tstring& rootBoneName, float duration);
+	bool ActivateRagdollRegion(NxActor* pHitActor, const D3DXVECTOR3& hitPoint, float duration);
+
+	//Physics LOD tier of the ragdoll, chosen every frame by distance and importance (see RagdollLod.h)
+	void SetRagdollLod(RagdollLod lod);
+	RagdollLod GetRagdollLod() const;
+
+	//Checking if Enemy Ragdoll Actors are moving (SeedState and not settled yet)
 	bool IsEnemyMoving() const;
+	//Dead enemies bake their ragdoll once it settles: frozen pose, no actors.
+	//Wake brings the actors back (something pushes the corpse).
+	void BakeRagdoll();
+	void WakeRagdoll();
+	bool IsRagdollBaked() const;
+	//Leave a static box behind when baking, so the corpse can still be stood on
+	void SetKeepCorpseCollider(bool keep){m_bKeepCorpseCollider = keep;};
+	//Settle events of our ragdoll
+	virtual void OnRagdollSettled(PhysicsAnimator* pAnimator);
+	virtual void OnRagdollWoken(PhysicsAnimator* pAnimator);
+	virtual void OnRagdollStateChanged(PhysicsAnimator* pAnimator, RagdollState state);
+	virtual void OnRagdollMigrated(PhysicsAnimator* pAnimator);
 
 	//Checking if Enemy is pickable + set the state
 	bool IsEnemyPickable() const { return m_bIsPickable;};
@@ -94,6 +131,8 @@ private:
 	float m_fWalkSpeed;
 	float m_fMaximumWalkingSpeed;
 
+	bool m_bRagdollSettled; //Our ragdoll came to rest (settle events of the PhysicsAnimator)
+	bool m_bKeepCorpseCollider; //Bake with a static collider
 	float m_fCurrentRecoverTime; //Time enemy is paralyzed and not moving
 	float m_fTotalRecoverTime; //Time enemy need to be paralyzed before it recovers
 
@@ -106,6 +145,9 @@ private:
 
 	bool m_bIsShowcase; //Always puts the enemy Walking State
 
+	float m_fContactReportThreshold; //ContactReport settings of the ragdoll actors
+	NxU32 m_iContactReportFlags;
+
 	//METHODS
 	//Moves our enemy to a certain target (rotation model + hold with reaches target)
 	void MoveEnemyController(GameContext& context);
@@ -113,6 +155,8 @@ private:
 	bool HasContactWithFloor(D3DXVECTOR3 position) const;
 	//Get position rootbone
 	D3DXVECTOR3 GetPositionRootBone() const;
+	//Picks the LOD tier of the ragdoll and tells the RagdollBudget how much we matter
+	void UpdateRagdollLod(GameContext& context);
 
 	// -------------------------
 	// Disabling default copy constructor and default 
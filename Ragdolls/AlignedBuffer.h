@@ -0,0 +1,69 @@
+#ifndef ALIGNEDBUFFER_H_INCLUDED_
+#define ALIGNEDBUFFER_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// Fixed size, cache aligned array used for the hot per-bone data of the ragdolls
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include <malloc.h>
+
+//Only meant for plain data (matrices, ints, ...). No constructors or destructors are called!
+template<typename T, UINT Alignment = 64>
+class AlignedBuffer final
+{
+public:
+	AlignedBuffer(void):
+		m_pData(nullptr), m_iSize(0)
+	{}
+	~AlignedBuffer(void)
+	{
+		Release();
+	}
+
+	//Allocates room for the amount of elements. Previous content is discarded.
+	void Resize(UINT size)
+	{
+		Release();
+		if(size == 0)
+			return;
+
+		m_pData = static_cast<T*>(_aligned_malloc(sizeof(T) * size, Alignment));
+		if(m_pData != nullptr)
+			m_iSize = size;
+	}
+
+	//Sets all elements to the same value
+	void Fill(const T& value)
+	{
+		for(UINT i=0; i < m_iSize; ++i)
+			m_pData[i] = value;
+	}
+
+	void Release()
+	{
+		if(m_pData != nullptr)
+			_aligned_free(m_pData);
+		m_pData = nullptr;
+		m_iSize = 0;
+	}
+
+	T* GetData() {return m_pData;};
+	const T* GetData() const {return m_pData;};
+	UINT GetSize() const {return m_iSize;};
+
+	T& operator[](UINT index) {return m_pData[index];};
+	const T& operator[](UINT index) const {return m_pData[index];};
+
+private:
+	T* m_pData;
+	UINT m_iSize;
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	AlignedBuffer(const AlignedBuffer& yRef);
+	AlignedBuffer& operator=(const AlignedBuffer& yRef);
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef ARRAYVIEW_H_INCLUDED_
+#define ARRAYVIEW_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// Non-owning view on a contiguous array, used to share ragdoll data without copies
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include <vector>
+
+//The view never owns the data. The owner must outlive every view it hands out.
+template<typename T>
+class ArrayView final
+{
+public:
+	ArrayView(void):
+		m_pData(nullptr), m_iSize(0)
+	{}
+	ArrayView(T* pData, UINT size):
+		m_pData(pData), m_iSize(size)
+	{}
+	//Views on vectors (const view on const vector, mutable view on mutable vector)
+	template<typename U>
+	ArrayView(std::vector<U>& vec):
+		m_pData(vec.empty() ? nullptr : &vec[0]), m_iSize(vec.size())
+	{}
+	template<typename U>
+	ArrayView(const std::vector<U>& vec):
+		m_pData(vec.empty() ? nullptr : &vec[0]), m_iSize(vec.size())
+	{}
+	//A mutable view converts to a const view
+	template<typename U>
+	ArrayView(const ArrayView<U>& other):
+		m_pData(other.GetData()), m_iSize(other.size())
+	{}
+
+	T* GetData() const {return m_pData;};
+	UINT size() const {return m_iSize;};
+	bool empty() const {return m_iSize == 0;};
+
+	T* begin() const {return m_pData;};
+	T* end() const {return m_pData + m_iSize;};
+	T& operator[](UINT index) const {return m_pData[index];};
+	T& at(UINT index) const
+	{
+		ASSERT(index < m_iSize, _T("ArrayView index out of range!"));
+		return m_pData[index];
+	};
+
+private:
+	T* m_pData;
+	UINT m_iSize;
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,46 @@
+//--------------------------------------------------------------------------------------
+// BoneNameTable: interns bone names to integer ids, so bones can be looked up and
+// compared without touching strings once a definition has been loaded
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "BoneNameTable.h"
+
+BoneNameTable* BoneNameTable::m_pInstance = nullptr;
+
+BoneNameTable* BoneNameTable::GetInstance()
+{
+	if(m_pInstance == nullptr)
+		m_pInstance = new BoneNameTable();
+	return m_pInstance;
+}
+
+void BoneNameTable::DestroyInstance()
+{
+	SafeDelete(m_pInstance);
+}
+
+BoneNameId BoneNameTable::Intern(const tstring& name)
+{
+	auto it = m_Ids.find(name);
+	if(it != m_Ids.end())
+		return it->second;
+
+	BoneNameId id = m_vNames.size();
+	m_vNames.push_back(name);
+	m_Ids[name] = id;
+	return id;
+}
+
+BoneNameId BoneNameTable::Intern(const char* name)
+{
+	//Cooked names are ASCII
+	return Intern(tstring(name, name + strlen(name)));
+}
+
+BoneNameId BoneNameTable::Find(const tstring& name) const
+{
+	auto it = m_Ids.find(name);
+	if(it != m_Ids.end())
+		return it->second;
+	return INVALID_BONE_NAME;
+}
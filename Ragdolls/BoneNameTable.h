@@ -0,0 +1,50 @@
+#ifndef BONENAMETABLE_H_INCLUDED_
+#define BONENAMETABLE_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// BoneNameTable: interns bone names to integer ids, so bones can be looked up and
+// compared without touching strings once a definition has been loaded
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include <vector>
+#include <unordered_map>
+
+typedef UINT BoneNameId;
+const BoneNameId INVALID_BONE_NAME = 0xFFFFFFFF;
+
+class BoneNameTable final
+{
+public:
+	static BoneNameTable* GetInstance();
+	static void DestroyInstance();
+
+	//METHODS
+	//Returns the id of the name, adds the name if it's new. Only used while loading.
+	BoneNameId Intern(const tstring& name);
+	BoneNameId Intern(const char* name);
+	//Returns the id of the name, INVALID_BONE_NAME if it was never interned
+	BoneNameId Find(const tstring& name) const;
+
+	//GETTERS
+	const tstring& GetName(BoneNameId id) const {return m_vNames[id];};
+	UINT GetAmountOfNames() const {return m_vNames.size();};
+
+private:
+	BoneNameTable(void){};
+	~BoneNameTable(void){};
+
+	static BoneNameTable* m_pInstance;
+
+	//Ids are indices in m_vNames, they never change while the table exists
+	std::unordered_map<tstring, BoneNameId> m_Ids;
+	vector<tstring> m_vNames;
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	BoneNameTable(const BoneNameTable& yRef);
+	BoneNameTable& operator=(const BoneNameTable& yRef);
+};
+#endif
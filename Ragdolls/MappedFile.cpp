@@ -0,0 +1,68 @@
+//--------------------------------------------------------------------------------------
+// Read-only memory mapped file (RAII), used to load cooked ragdoll definitions in place
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "MappedFile.h"
+
+MappedFile::MappedFile(void):
+	m_hFile(INVALID_HANDLE_VALUE),
+	m_hMapping(NULL),
+	m_pData(nullptr),
+	m_iSize(0)
+{
+}
+
+MappedFile::~MappedFile(void)
+{
+	Close();
+}
+
+bool MappedFile::Open(const tstring& path)
+{
+	Close();
+
+	m_hFile = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+	if(m_hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	//Empty files can't be mapped
+	DWORD size = GetFileSize(m_hFile, NULL);
+	if(size == 0 || size == INVALID_FILE_SIZE)
+	{
+		Close();
+		return false;
+	}
+
+	m_hMapping = CreateFileMapping(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(m_hMapping == NULL)
+	{
+		Close();
+		return false;
+	}
+
+	m_pData = static_cast<const BYTE*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+	if(m_pData == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	m_iSize = size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(m_pData != nullptr)
+		UnmapViewOfFile(m_pData);
+	if(m_hMapping != NULL)
+		CloseHandle(m_hMapping);
+	if(m_hFile != INVALID_HANDLE_VALUE)
+		CloseHandle(m_hFile);
+
+	m_pData = nullptr;
+	m_hMapping = NULL;
+	m_hFile = INVALID_HANDLE_VALUE;
+	m_iSize = 0;
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef MAPPEDFILE_H_INCLUDED_
+#define MAPPEDFILE_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// Read-only memory mapped file (RAII), used to load cooked ragdoll definitions in place
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+
+class MappedFile final
+{
+public:
+	MappedFile(void);
+	~MappedFile(void);
+
+	//Maps the whole file, returns false if the file could not be opened or mapped
+	bool Open(const tstring& path);
+	void Close();
+
+	const BYTE* GetData() const {return m_pData;};
+	UINT GetSize() const {return m_iSize;};
+	bool IsOpen() const {return m_pData != nullptr;};
+
+private:
+	HANDLE m_hFile;
+	HANDLE m_hMapping;
+	const BYTE* m_pData;
+	UINT m_iSize;
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	MappedFile(const MappedFile& yRef);
+	MappedFile& operator=(const MappedFile& yRef);
+};
+#endif
\ No newline at end of file
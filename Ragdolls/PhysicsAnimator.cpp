@@ -3,361 +3,708 @@
 // Created by Matthieu Delaere
 //--------------------------------------------------------------------------------------
 #include "PhysicsAnimator.h"
+#include "RagdollPool.h"
+#include "RagdollProxy.h"
+#include "RagdollReleaseQueue.h"
+#include "RagdollBudget.h"
+#include "RagdollTransitionQueue.h"
+#include "RagdollUpdateBatch.h"
+#include "RagdollCommandBuffer.h"
+#include "RagdollPosePipeline.h"
+#include "RagdollSceneShards.h"
 #include "../../../OverlordEngine/Managers/PhysicsManager.h"
 #include "../../../OverlordEngine/Diagnostics/Logger.h"
 
+//Name of the static actor a baked ragdoll leaves behind, compared by pointer
+static const char* const RAGDOLL_BAKED_COLLIDER_NAME = "RagdollBakedCollider";
+
 PhysicsAnimator::PhysicsAnimator(NxScene* pScene, MeshFilter* pMeshFilter, ModelComponent* ownerModelComponent):
 	m_pPhysicsScene(pScene),
 	m_pMeshFilter(pMeshFilter),
-	m_pOwnerModelComponent(ownerModelComponent),
 	m_pPhysxSkeleton(nullptr),
-	m_currentRagdollState(RagdollState::LeechState)
+	m_currentRagdollState(RagdollState::LeechState),
+	m_requestedRagdollState(RagdollState::LeechState),
+	m_bTransitionQueued(false),
+	m_nxPhysxGroup(PhysicsGroup::Layer0),
+	m_eTargetLod(RagdollLod::LodFull),
+	m_pSettleListener(nullptr),
+	m_bBaked(false),
+	m_pBakedCollider(nullptr),
+	m_eBudgetLevel(RagdollBudgetLevel::BudgetSimulated),
+	m_fBudgetDistance(0.0f),
+	m_bBudgetImportant(false),
+	m_fSimulatedTime(0.0f),
+	m_pLeechProxy(nullptr),
+	m_bUseLeechProxy(false),
+	m_fJointReleaseDelay(5.0f),
+	m_fJointReleaseTimer(0.0f),
+	m_fRegionTimer(-1.0f),
+	m_bBatchQueued(false),
+	m_pOwnerModelComponent(ownerModelComponent)
 {
 	///Make sure our worldTransform is initialized is identity so it won't be put
 	//in the wrong place if no concrete worldtransform is given allready
 	D3DXMatrixIdentity(&m_matWorldTransform);
 
-	//Fill the transform vectors with identity matrices for the amount of bones present.
-	//We need to do this to ensure if someone would call this vector before we did any 
+	//Fill the pose buffer with identity matrices for the amount of bones present.
+	//We need to do this to ensure if someone would read the buffer before we did any 
 	//any calculations
 	D3DXMATRIX identityMatrix;
 	D3DXMatrixIdentity(&identityMatrix);
 	if(m_pMeshFilter != nullptr)
 	{
-		for(UINT i=0; i < m_pMeshFilter->GetSkeleton().size(); ++i)
-		{
-			m_BoneOriginalTransforms.push_back(identityMatrix);
-			m_BonePhysicsTransforms.push_back(identityMatrix);
-		}
+		m_BoneTransforms.Resize(m_pMeshFilter->GetSkeleton().size());
+		m_BoneTransforms.Fill(identityMatrix);
 	}
+
+	RagdollBudget::GetInstance()->Register(this);
+	RagdollSceneShards::GetInstance()->Register(this);
 }
 
 PhysicsAnimator::~PhysicsAnimator(void)
 {
-	SafeDelete(m_pPhysxSkeleton);
+	RagdollBudget::GetInstance()->Unregister(this);
+	RagdollSceneShards::GetInstance()->Unregister(this);
+	if(m_bTransitionQueued)
+		RagdollTransitionQueue::GetInstance()->Remove(this);
+	if(m_bBatchQueued)
+		RagdollUpdateBatch::GetInstance()->Remove(this);
+
+	//The actors and joints go back to the pool, ready for the next enemy
+	ReleaseSkeleton();
+	ReleaseLeechProxy();
+	ReleaseBakedCollider();
 }
 
 void PhysicsAnimator::BuildPhysicsSkeletonFromFile(PhysicsGroup group)
 {
-	//TEST IS NOT ERROR PRONE... THIS IS FOR TESTING THE TOOL ONLY!!!!! USING AN APPROVED SETUP!
-	if(m_pPhysicsScene)
-	{
-		//Create skeleton
-		if(m_pPhysxSkeleton != nullptr)
-			delete m_pPhysxSkeleton;
-		m_pPhysxSkeleton = new PhysxSkeleton(m_pPhysicsScene, group, this);
+	//Path hardcoded for testing! The cooked file is only mapped once per model, every next enemy reuses the definition.
+	//If it hasn't been cooked yet, GameSkeleton.xml is cooked at runtime.
+	BuildPhysicsSkeleton(RagdollDefinitionCache::GetInstance()->GetDefinition(
+		_T("./SZS_Resources/Skeleton/GameSkeleton.ragdoll"), m_pMeshFilter, RagdollDefinitionCache::HashSkeleton(m_pMeshFilter)), group);
+}
 
-		//---------------------------------------------------------
-		//Create a document on the stack (RAII)
-		pugi::xml_document doc;
-		//Load a document and see if it has been found - path hardcoded for testing!
-		pugi::xml_parse_result result = doc.load_file(_T("./SZS_Resources/Skeleton/GameSkeleton.xml"));
+void PhysicsAnimator::BuildPhysicsSkeleton(PhysicsGroup group)
+{
+	//The humanoid has a definition for every LOD tier, all for the same skeleton
+	const UINT skeletonHash = RagdollDefinitionCache::HashSkeleton(m_pMeshFilter);
+	for(int lod=0; lod < RagdollLod::LodCount; ++lod)
+		m_pLodDefinitions[lod] = RagdollDefinitionCache::GetInstance()->GetHumanoidDefinition(m_pMeshFilter, skeletonHash, (RagdollLod)lod);
 
-		//Root Node
-		pugi::xml_node rs = doc.child(_T("RagdollSkeleton"));
+	if(m_pLodDefinitions[m_eTargetLod])
+		BuildFromDefinition(m_pLodDefinitions[m_eTargetLod], group);
+	else
+		BuildFromDefinition(m_pLodDefinitions[RagdollLod::LodFull], group);
+}
 
-		//---------------------------------------------------------
-		//Load BoneLayouts
-		pugi::xml_node boneLayouts = rs.child(_T("BoneLayouts"));
+void PhysicsAnimator::BuildPhysicsSkeleton(const std::shared_ptr<const RagdollDefinition>& pDefinition, PhysicsGroup group)
+{
+	//Only one tier
+	for(int lod=0; lod < RagdollLod::LodCount; ++lod)
+		m_pLodDefinitions[lod].reset();
+	m_pLodDefinitions[RagdollLod::LodFull] = pDefinition;
 
-		vector<PhysxBoneLayout> vecBoneLayouts;
-		for(pugi::xml_node node = boneLayouts.child(_T("Bone")); node != nullptr; node = node.next_sibling(_T("Bone")))
-		{
-			PhysxBoneLayout boneLayout;
-			boneLayout.name = node.attribute(_T("name")).as_string();
-			boneLayout.height = node.attribute(_T("height")).as_float();
-			boneLayout.radius = node.attribute(_T("radius")).as_float();
-			boneLayout.shapeType = (RagdollShapeType)node.attribute(_T("type")).as_int();
-
-			m_pPhysxSkeleton->AddBone(boneLayout);
-			vecBoneLayouts.push_back(boneLayout);
-		}
+	BuildFromDefinition(pDefinition, group);
+}
 
-		//---------------------------------------------------------
-		//Load BoneJoints
-		pugi::xml_node boneJoints = rs.child(_T("BoneJoints"));
+void PhysicsAnimator::BuildFromDefinition(const std::shared_ptr<const RagdollDefinition>& pDefinition, PhysicsGroup group)
+{
+	if(m_pPhysicsScene == nullptr)
+		return;
+	if(!pDefinition)
+	{
+		Logger::Log(_T("PhysicsAnimator: No valid ragdoll definition, no skeleton created!"), LogLevel::Error);
+		return;
+	}
 
-		for(pugi::xml_node node = boneJoints.child(_T("Joint")); node != nullptr; node = node.next_sibling(_T("Joint")))
-		{
-			PhysxJointLayout jointLayout;
-			jointLayout.jointType = (JointType)node.attribute(_T("type")).as_int();
-
-			tstring bone1Name = node.attribute(_T("bone1")).as_string();
-			tstring bone2Name = node.attribute(_T("bone2")).as_string();
-			auto bone1Layout = *find_if(vecBoneLayouts.begin(), vecBoneLayouts.end(), [&] (PhysxBoneLayout boneLayout) { 
-				return (boneLayout.name == bone1Name);});
-			auto bone2Layout = *find_if(vecBoneLayouts.begin(), vecBoneLayouts.end(), [&] (PhysxBoneLayout boneLayout) { 
-				return (boneLayout.name == bone2Name);});
-
-			jointLayout.pBone1 = m_pPhysxSkeleton->GetPhysxBone(bone1Layout);
-			jointLayout.pBone2 = m_pPhysxSkeleton->GetPhysxBone(bone2Layout);
-			jointLayout.anchorBone = JointBone::PhysxBone2;
-
-			NxVec3 axisOrietation;
-			axisOrietation.x = node.attribute(_T("axis-x")).as_float();
-			axisOrietation.y = node.attribute(_T("axis-y")).as_float();
-			axisOrietation.z = node.attribute(_T("axis-z")).as_float();
-			jointLayout.axisOrientation = axisOrietation;
-
-			m_pPhysxSkeleton->AddJoint(jointLayout);
-		}
+	ReleaseSkeleton();
+	ReleaseLeechProxy();
+	m_pDefinition = pDefinition;
+	m_nxPhysxGroup = group;
 
-		//---------------------------------------------------------
-		//Build skeleton
-		m_pPhysxSkeleton->Initiliaze(m_pMeshFilter);
-		m_pPhysxSkeleton->CreateJoints();
+	//While animated, a proxy is enough. The skeleton is taken when we go to SeedState.
+	if(m_bUseLeechProxy && m_currentRagdollState == RagdollState::LeechState)
+	{
+		AcquireLeechProxy();
+		return;
 	}
+
+	AcquireSkeleton();
+	if(m_currentRagdollState == RagdollState::SeedState)
+		PrepareForSeed();
 }
 
-void PhysicsAnimator::BuildPhysicsSkeleton(PhysicsGroup group)
+void PhysicsAnimator::AcquireSkeleton()
+{
+	if(m_pPhysxSkeleton != nullptr || !m_pDefinition)
+		return;
+
+	//Get a skeleton from the pool, it is only built if there is no parked one left
+	m_pPhysxSkeleton = RagdollPool::GetInstance()->Acquire(m_pPhysicsScene, m_nxPhysxGroup, m_pDefinition, this);
+	if(m_pPhysxSkeleton == nullptr)
+		return;
+
+	//The skeleton comes in LeechState, at the parking spot
+	m_pPhysxSkeleton->SetWorldTransform(m_matWorldTransform);
+}
+
+void PhysicsAnimator::ReleaseSkeleton()
 {
-	if(m_pPhysicsScene)
+	//Pooled skeletons go back with the solver iterations of their tier
+	ResetBudgetLevel();
+	RagdollPool::GetInstance()->Release(m_pPhysxSkeleton);
+	m_pPhysxSkeleton = nullptr;
+}
+
+void PhysicsAnimator::AcquireLeechProxy()
+{
+	if(m_pLeechProxy != nullptr || !m_pDefinition)
+		return;
+
+	m_pLeechProxy = RagdollPool::GetInstance()->AcquireProxy(m_pPhysicsScene, m_nxPhysxGroup, m_pDefinition, this);
+	UpdateLeechProxy();
+}
+
+void PhysicsAnimator::ReleaseLeechProxy()
+{
+	RagdollPool::GetInstance()->ReleaseProxy(m_pLeechProxy, m_pDefinition.get());
+	m_pLeechProxy = nullptr;
+}
+
+void PhysicsAnimator::UpdateLeechProxy()
+{
+	if(m_pLeechProxy == nullptr || m_BoneTransforms.GetSize() == 0)
+		return;
+
+	//Follow the root bone over the ground, the capsule itself stays upright
+	const int rootBoneIndex = m_pDefinition->GetBoneIndices()[0];
+	D3DXMATRIX matRoot = m_pDefinition->GetTotalOffsets()[0] * m_BoneTransforms[rootBoneIndex];
+	D3DXMATRIX matFollow;
+	D3DXMatrixTranslation(&matFollow, matRoot._41, 0.0f, matRoot._43);
+	m_pLeechProxy->SetGlobalPose(matFollow * m_matWorldTransform);
+}
+
+void PhysicsAnimator::SetLod(RagdollLod lod)
+{
+	if(m_eTargetLod == lod)
+		return;
+	m_eTargetLod = lod;
+
+	//We can't swap the bodies of a ragdoll that is simulating, PrepareForLeech or DeactivateRegion does it later
+	if(m_currentRagdollState == RagdollState::LeechState && !HasActiveRegion())
+		ApplyLod();
+}
+
+void PhysicsAnimator::ApplyLod()
+{
+	const std::shared_ptr<const RagdollDefinition>& pLodDefinition = m_pLodDefinitions[m_eTargetLod];
+	if(!pLodDefinition || pLodDefinition == m_pDefinition)
+		return;
+
+	//Both come from the pool, so switching back and forth doesn't build anything new
+	bool hadProxy = (m_pLeechProxy != nullptr);
+	bool hadSkeleton = (m_pPhysxSkeleton != nullptr);
+	ReleaseSkeleton();
+	ReleaseLeechProxy();
+	m_pDefinition = pLodDefinition;
+	if(hadProxy)
+		AcquireLeechProxy();
+	if(hadSkeleton)
+		AcquireSkeleton();
+}
+
+void PhysicsAnimator::SetLeechProxyEnabled(bool enabled)
+{
+	if(m_bUseLeechProxy == enabled)
+		return;
+	m_bUseLeechProxy = enabled;
+
+	//In SeedState we need the skeleton anyway, the switch happens when we go back to LeechState
+	if(m_currentRagdollState != RagdollState::LeechState || !m_pDefinition)
+		return;
+
+	if(m_bUseLeechProxy)
 	{
-		//Create skeleton
-		m_pPhysxSkeleton = new PhysxSkeleton(m_pPhysicsScene, group, this);
-
-		//---------------------------------------------------------
-		//Bone 1
-		PhysxBoneLayout boneLayout1;
-		boneLayout1.name = _T("Spine0");
-		boneLayout1.height = 0.15f;
-		boneLayout1.radius = 0.2f;
-		boneLayout1.shapeType = RagdollShapeType::capsule;
-
-		m_pPhysxSkeleton->AddBone(boneLayout1);
-
-		//Bone 2
-		PhysxBoneLayout boneLayout2;
-		boneLayout2.name = _T("Spine1");
-		boneLayout2.height = 0.025f;
-		boneLayout2.radius = 0.45f;
-		boneLayout2.shapeType = RagdollShapeType::capsule;
-
-		m_pPhysxSkeleton->AddBone(boneLayout2);
-
-		//Bone 3
-		PhysxBoneLayout boneLayout3;
-		boneLayout3.name = _T("Head");
-		boneLayout3.radius = 0.65f;
-		boneLayout3.shapeType = RagdollShapeType::sphere;
-
-		m_pPhysxSkeleton->AddBone(boneLayout3);
-
-		//Bone 4
-		PhysxBoneLayout boneLayout4;
-		boneLayout4.name = _T("RightUpperArm");
-		boneLayout4.height = 0.35f;
-		boneLayout4.radius = 0.15f;
-		boneLayout4.shapeType = RagdollShapeType::capsule;
-
-		m_pPhysxSkeleton->AddBone(boneLayout4);
-
-		//Bone 5
-		PhysxBoneLayout boneLayout5;
-		boneLayout5.name = _T("RightLowerArm");
-		boneLayout5.height = 0.35f;
-		boneLayout5.radius = 0.15f;
-		boneLayout5.shapeType = RagdollShapeType::capsule;
-
-		m_pPhysxSkeleton->AddBone(boneLayout5);
-
-		//Bone 6
-		PhysxBoneLayout boneLayout6;
-		boneLayout6.name = _T("LeftUpperArm");
-		boneLayout6.height = 0.35f;
-		boneLayout6.radius = 0.15f;
-		boneLayout6.shapeType = RagdollShapeType::capsule;
-
-		m_pPhysxSkeleton->AddBone(boneLayout6);
-
-		//Bone 7
-		PhysxBoneLayout boneLayout7;
-		boneLayout7.name = _T("LeftLowerArm");
-		boneLayout7.height = 0.35f;
-		boneLayout7.radius = 0.15f;
-		boneLayout7.shapeType = RagdollShapeType::capsule;
-
-		m_pPhysxSkeleton->AddBone(boneLayout7);
-
-		//Bone 8
-		PhysxBoneLayout boneLayout8;
-		boneLayout8.name = _T("RightUpperLeg");
-		boneLayout8.height = 0.3f;
-		boneLayout8.radius = 0.2f;
-		boneLayout8.shapeType = RagdollShapeType::capsule;
-
-		m_pPhysxSkeleton->AddBone(boneLayout8);
-
-		//Bone 9
-		PhysxBoneLayout boneLayout9;
-		boneLayout9.name = _T("RightLowerLeg");
-		boneLayout9.height = 0.5f;
-		boneLayout9.radius = 0.2f;
-		boneLayout9.shapeType = RagdollShapeType::capsule;
-
-		m_pPhysxSkeleton->AddBone(boneLayout9);
-
-		//Bone 10
-		PhysxBoneLayout boneLayout10;
-		boneLayout10.name = _T("LeftUpperLeg");
-		boneLayout10.height = 0.3f;
-		boneLayout10.radius = 0.2f;
-		boneLayout10.shapeType = RagdollShapeType::capsule;
-
-		m_pPhysxSkeleton->AddBone(boneLayout10);
-
-		//Bone 11
-		PhysxBoneLayout boneLayout11;
-		boneLayout11.name = _T("LeftLowerLeg");
-		boneLayout11.height = 0.5f;
-		boneLayout11.radius = 0.2f;
-		boneLayout11.shapeType = RagdollShapeType::capsule;
-
-		m_pPhysxSkeleton->AddBone(boneLayout11);
-
-		//---------------------------------------------------------
-		//The axisOrientation is in global space.
-		//If you want to give it a certain direction you need to add
-		//the normalized direction yourself. 
-		//Information normalize manually: http://www.fundza.com/vectors/normalize/
-		//Eg: Normalize(position2 - position1).
-
-		//Joint 1
-		PhysxJointLayout jointLayout;
-		jointLayout.jointType = JointType::spherical;
-		jointLayout.pBone1 = m_pPhysxSkeleton->GetPhysxBone(boneLayout1);
-		jointLayout.pBone2 = m_pPhysxSkeleton->GetPhysxBone(boneLayout2);
-		jointLayout.anchorBone = JointBone::PhysxBone2;
-		jointLayout.axisOrientation = NxVec3(0,1,0);
-
-		m_pPhysxSkeleton->AddJoint(jointLayout);
-
-		//Joint 2
-		PhysxJointLayout jointLayout2;
-		jointLayout2.jointType = JointType::spherical;
-		jointLayout2.pBone1 = m_pPhysxSkeleton->GetPhysxBone(boneLayout2);
-		jointLayout2.pBone2 = m_pPhysxSkeleton->GetPhysxBone(boneLayout3);
-		jointLayout2.anchorBone = JointBone::PhysxBone2;
-		jointLayout2.axisOrientation = NxVec3(0,1,0);
-
-		m_pPhysxSkeleton->AddJoint(jointLayout2);
-
-		//Joint 3
-		PhysxJointLayout jointLayout3;
-		jointLayout3.jointType = JointType::spherical;
-		jointLayout3.pBone1 = m_pPhysxSkeleton->GetPhysxBone(boneLayout2);
-		jointLayout3.pBone2 = m_pPhysxSkeleton->GetPhysxBone(boneLayout4);
-		jointLayout3.anchorBone = JointBone::PhysxBone2;
-		jointLayout3.axisOrientation = NxVec3(-0.32197f,-0.946653f,0);
-
-		m_pPhysxSkeleton->AddJoint(jointLayout3);
-
-		//Joint 4
-		PhysxJointLayout jointLayout4;
-		jointLayout4.jointType = JointType::spherical; //rev
-		jointLayout4.pBone1 = m_pPhysxSkeleton->GetPhysxBone(boneLayout4);
-		jointLayout4.pBone2 = m_pPhysxSkeleton->GetPhysxBone(boneLayout5);
-		jointLayout4.anchorBone = JointBone::PhysxBone2;
-		jointLayout4.axisOrientation = NxVec3(-0.32197f,-0.946653f,0);
-
-		m_pPhysxSkeleton->AddJoint(jointLayout4);
-
-		//Joint 5
-		PhysxJointLayout jointLayout5;
-		jointLayout5.jointType = JointType::spherical;
-		jointLayout5.pBone1 = m_pPhysxSkeleton->GetPhysxBone(boneLayout2);
-		jointLayout5.pBone2 = m_pPhysxSkeleton->GetPhysxBone(boneLayout6);
-		jointLayout5.anchorBone = JointBone::PhysxBone2;
-		jointLayout5.axisOrientation = NxVec3(0.285960f,-0.9582864f,0);
-
-		m_pPhysxSkeleton->AddJoint(jointLayout5);
-
-		//Joint 6
-		PhysxJointLayout jointLayout6;
-		jointLayout6.jointType = JointType::spherical; //rev
-		jointLayout6.pBone1 = m_pPhysxSkeleton->GetPhysxBone(boneLayout6);
-		jointLayout6.pBone2 = m_pPhysxSkeleton->GetPhysxBone(boneLayout7);
-		jointLayout6.anchorBone = JointBone::PhysxBone2;
-		jointLayout6.axisOrientation = NxVec3(0.285960f,-0.9582864f,0);
-
-		m_pPhysxSkeleton->AddJoint(jointLayout6);
-
-		//Joint 7
-		PhysxJointLayout jointLayout7;
-		jointLayout7.jointType = JointType::spherical;
-		jointLayout7.pBone1 = m_pPhysxSkeleton->GetPhysxBone(boneLayout1);
-		jointLayout7.pBone2 = m_pPhysxSkeleton->GetPhysxBone(boneLayout8);
-		jointLayout7.anchorBone = JointBone::PhysxBone2;
-		jointLayout7.axisOrientation = NxVec3(0,-1,0);
-
-		m_pPhysxSkeleton->AddJoint(jointLayout7);
-
-		//Joint 8
-		PhysxJointLayout jointLayout8;
-		jointLayout8.jointType = JointType::spherical; //rev
-		jointLayout8.pBone1 = m_pPhysxSkeleton->GetPhysxBone(boneLayout8);
-		jointLayout8.pBone2 = m_pPhysxSkeleton->GetPhysxBone(boneLayout9);
-		jointLayout8.anchorBone = JointBone::PhysxBone2;
-		jointLayout8.axisOrientation = NxVec3(0,-1,0);
-
-		m_pPhysxSkeleton->AddJoint(jointLayout8);
-
-		//Joint 9
-		PhysxJointLayout jointLayout9;
-		jointLayout9.jointType = JointType::spherical;
-		jointLayout9.pBone1 = m_pPhysxSkeleton->GetPhysxBone(boneLayout1);
-		jointLayout9.pBone2 = m_pPhysxSkeleton->GetPhysxBone(boneLayout10);
-		jointLayout9.anchorBone = JointBone::PhysxBone2;
-		jointLayout9.axisOrientation = NxVec3(0,-1,0);
-
-		m_pPhysxSkeleton->AddJoint(jointLayout9);
-
-		//Joint 10
-		PhysxJointLayout jointLayout10;
-		jointLayout10.jointType = JointType::spherical; //rev
-		jointLayout10.pBone1 = m_pPhysxSkeleton->GetPhysxBone(boneLayout10);
-		jointLayout10.pBone2 = m_pPhysxSkeleton->GetPhysxBone(boneLayout11);
-		jointLayout10.anchorBone = JointBone::PhysxBone2;
-		jointLayout10.axisOrientation = NxVec3(0,-1,0);
-
-		m_pPhysxSkeleton->AddJoint(jointLayout10);
-
-		//---------------------------------------------------------
-		//Build skeleton
-		m_pPhysxSkeleton->Initiliaze(m_pMeshFilter);
-		m_pPhysxSkeleton->CreateJoints();
+		ReleaseSkeleton();
+		AcquireLeechProxy();
+	}
+	else
+	{
+		ReleaseLeechProxy();
+		AcquireSkeleton();
 	}
 }
 
 void PhysicsAnimator::UpdateLeechMode(GameContext& context)
 {
+	//The proxy is a single actor, it always follows the animation
+	if(m_currentRagdollState == RagdollState::LeechState)
+		UpdateLeechProxy();
+
 	if(m_pPhysxSkeleton != nullptr 
 		&& m_currentRagdollState == RagdollState::LeechState)
 	{
-		//Feed the Animation Data to the PhysxSkeleton if in LeechState
-		m_pPhysxSkeleton->FeedBoneTransforms(m_BoneOriginalTransforms);
+		//The batch updates all skeletons together, later this frame
+		if(RagdollUpdateBatch::GetInstance()->IsEnabled())
+		{
+			if(!m_bBatchQueued)
+				RagdollUpdateBatch::GetInstance()->QueueLeech(this);
+			m_bBatchQueued = true;
+			return;
+		}
+
+		//The skeleton reads the animation data straight from our pose buffer
 		//Update the skeleton
 		m_pPhysxSkeleton->UpdateLeechMode(context);
+		FinishLeechUpdate(context.GameTime.ElapsedSeconds());
+	}
+}
+
+void PhysicsAnimator::FinishLeechUpdate(float deltaTime)
+{
+	m_bBatchQueued = false;
+	if(m_pPhysxSkeleton == nullptr || m_currentRagdollState != RagdollState::LeechState)
+		return;
+
+	//The hit reaction is over, back to the animation
+	if(m_pPhysxSkeleton->HasActiveRegion() && m_fRegionTimer >= 0.0f)
+	{
+		m_fRegionTimer -= deltaTime;
+		if(m_fRegionTimer <= 0.0f)
+			DeactivateRegion();
+	}
+
+	//Kinematic actors don't need joints, drop them once we've been walking for a while.
+	//A region hangs from them.
+	if(m_pPhysxSkeleton != nullptr && !m_pPhysxSkeleton->HasActiveRegion()
+		&& m_fJointReleaseDelay >= 0.0f && m_pPhysxSkeleton->HasJoints())
+	{
+		m_fJointReleaseTimer -= deltaTime;
+		if(m_fJointReleaseTimer <= 0.0f)
+			m_pPhysxSkeleton->ReleaseJoints();
 	}
 }
 
 void PhysicsAnimator::UpdateSeedMode(GameContext& context)
 {
+	//The animation keeps writing in the pose buffer, put the frozen pose back over it
+	if(m_bBaked || m_eBudgetLevel == RagdollBudgetLevel::BudgetFrozen)
+	{
+		memcpy(m_BoneTransforms.GetData(), m_FrozenBoneTransforms.GetData(), sizeof(D3DXMATRIX) * m_BoneTransforms.GetSize());
+		return;
+	}
+
 	if(m_pPhysxSkeleton != nullptr &&
 		m_currentRagdollState == RagdollState::SeedState)
 	{
-		//Calculate the new bone transform
+		//The batch updates all skeletons together, later this frame
+		if(RagdollUpdateBatch::GetInstance()->IsEnabled())
+		{
+			if(!m_bBatchQueued)
+				RagdollUpdateBatch::GetInstance()->QueueSeed(this);
+			m_bBatchQueued = true;
+			return;
+		}
+
+		//Calculate the new bone transforms, written in our pose buffer by the skeleton
 		m_pPhysxSkeleton->UpdateSeedMode(context);
-		//Store them so we can seed them
-		m_BonePhysicsTransforms = m_pPhysxSkeleton->SeedBoneTransforms();
+		FinishSeedUpdate(context.GameTime.ElapsedSeconds());
+	}
+}
+
+void PhysicsAnimator::FinishSeedUpdate(float deltaTime)
+{
+	m_bBatchQueued = false;
+	if(m_pPhysxSkeleton == nullptr || m_currentRagdollState != RagdollState::SeedState || m_bBaked)
+		return;
+
+	m_fSimulatedTime += deltaTime;
+
+	//One check per ragdoll, the listener only hears about changes
+	RagdollSettleEvent settleEvent = m_pPhysxSkeleton->UpdateSettleState(deltaTime);
+	if(m_pSettleListener != nullptr)
+	{
+		if(settleEvent == RagdollSettleEvent::SettleSettled)
+			m_pSettleListener->OnRagdollSettled(this);
+		else if(settleEvent == RagdollSettleEvent::SettleWoken)
+			m_pSettleListener->OnRagdollWoken(this);
 	}
+
+	//Hit again, as interesting as a fresh ragdoll
+	if(settleEvent == RagdollSettleEvent::SettleWoken)
+		m_fSimulatedTime = 0.0f;
+}
+
+bool PhysicsAnimator::ActivateRegion(UINT slot, float duration)
+{
+	if(m_currentRagdollState != RagdollState::LeechState || !m_pDefinition || slot >= m_pDefinition->GetAmountOfBones())
+		return false;
+
+	//A few bodies need the skeleton as well, the proxy can't do this
+	AcquireSkeleton();
+	ReleaseLeechProxy();
+	if(m_pPhysxSkeleton == nullptr)
+		return false;
+
+	m_pPhysxSkeleton->ActivateRegion(slot);
+	m_fRegionTimer = duration;
+	return true;
+}
+
+bool PhysicsAnimator::ActivateRegion(BoneNameId rootBone, float duration)
+{
+	if(!m_pDefinition)
+		return false;
+
+	int slot = m_pDefinition->FindBoneSlot(rootBone);
+	if(slot < 0)
+		return false;
+	return ActivateRegion((UINT)slot, duration);
+}
+
+int PhysicsAnimator::FindNearestSlot(const D3DXVECTOR3& worldPosition) const
+{
+	if(!m_pDefinition)
+		return -1;
+
+	const D3DXMATRIX* pTotalOffsets = m_pDefinition->GetTotalOffsets();
+	const int* pBoneIndices = m_pDefinition->GetBoneIndices();
+	int nearestSlot = -1;
+	float nearestDistanceSq = FLT_MAX;
+	for(UINT slot=0; slot < m_pDefinition->GetAmountOfBones(); ++slot)
+	{
+		//The middle of the shape, it's placed along the y axis of the actor (see PhysxBone)
+		const RagdollBoneRecord& boneRecord = m_pDefinition->GetBoneRecord(slot);
+		float middle = boneRecord.radius;
+		if((RagdollShapeType)boneRecord.shapeType == RagdollShapeType::capsule)
+			middle += 0.5f * boneRecord.height;
+
+		D3DXMATRIX matActorWorld = pTotalOffsets[slot] * m_BoneTransforms[pBoneIndices[slot]] * m_matWorldTransform;
+		const D3DXVECTOR3 localCenter(0, middle, 0);
+		D3DXVECTOR3 center;
+		D3DXVec3TransformCoord(&center, &localCenter, &matActorWorld);
+
+		D3DXVECTOR3 offset = center - worldPosition;
+		float distanceSq = D3DXVec3LengthSq(&offset);
+		if(distanceSq < nearestDistanceSq)
+		{
+			nearestDistanceSq = distanceSq;
+			nearestSlot = slot;
+		}
+	}
+	return nearestSlot;
+}
+
+void PhysicsAnimator::DeactivateRegion()
+{
+	if(!HasActiveRegion() || m_currentRagdollState != RagdollState::LeechState)
+		return;
+
+	m_pPhysxSkeleton->DeactivateRegion();
+	m_fRegionTimer = -1.0f;
+	m_fJointReleaseTimer = m_fJointReleaseDelay;
+
+	//Back to how LeechState was before the hit: the proxy, and the LOD switch we held back
+	if(m_bUseLeechProxy)
+	{
+		ReleaseSkeleton();
+		ApplyLod();
+		AcquireLeechProxy();
+	}
+	else
+	{
+		ApplyLod();
+	}
+}
+
+bool PhysicsAnimator::Bake(bool keepCollider)
+{
+	if(m_bBaked || m_currentRagdollState != RagdollState::SeedState || m_pPhysxSkeleton == nullptr)
+		return false;
+
+	//The pose buffer holds the final pose of the ragdoll
+	m_FrozenBoneTransforms.Resize(m_BoneTransforms.GetSize());
+	memcpy(m_FrozenBoneTransforms.GetData(), m_BoneTransforms.GetData(), sizeof(D3DXMATRIX) * m_BoneTransforms.GetSize());
+
+	if(keepCollider)
+		CreateBakedCollider();
+
+	//Actors and joints go back to the pool, a corpse only costs its pose from now on
+	ReleaseSkeleton();
+	m_bBaked = true;
+	return true;
+}
+
+void PhysicsAnimator::Unbake()
+{
+	if(!m_bBaked)
+		return;
+
+	m_bBaked = false;
+	ReleaseBakedCollider();
+
+	//PrepareForSeed takes a skeleton from the pool and moves its actors to the frozen pose
+	memcpy(m_BoneTransforms.GetData(), m_FrozenBoneTransforms.GetData(), sizeof(D3DXMATRIX) * m_BoneTransforms.GetSize());
+	if(m_currentRagdollState == RagdollState::SeedState)
+		PrepareForSeed();
+}
+
+void PhysicsAnimator::SetBudgetLevel(RagdollBudgetLevel level)
+{
+	if(level == m_eBudgetLevel || m_pPhysxSkeleton == nullptr
+		|| m_currentRagdollState != RagdollState::SeedState || m_bBaked)
+		return;
+
+	//Thaw: dynamic again, from the pose it was frozen in
+	if(m_eBudgetLevel == RagdollBudgetLevel::BudgetFrozen)
+	{
+		for(auto physxBone : m_pPhysxSkeleton->GetPhysxBones())
+		{
+			physxBone->ClearBodyFlag(NX_BF_KINEMATIC);
+			RagdollCommandBuffer::GetInstance()->WakeUp(physxBone->GetActor(), m_pPhysxSkeleton);
+		}
+	}
+
+	if(level == RagdollBudgetLevel::BudgetFrozen)
+	{
+		//Hold the last simulated pose, the actors stop where they are (still colliding)
+		m_FrozenBoneTransforms.Resize(m_BoneTransforms.GetSize());
+		memcpy(m_FrozenBoneTransforms.GetData(), m_BoneTransforms.GetData(), sizeof(D3DXMATRIX) * m_BoneTransforms.GetSize());
+		for(auto physxBone : m_pPhysxSkeleton->GetPhysxBones())
+			physxBone->RaiseBodyFlag(NX_BF_KINEMATIC);
+	}
+
+	//The minimum for a downgraded ragdoll, the tier default otherwise
+	m_pPhysxSkeleton->SetSolverIterations(level == RagdollBudgetLevel::BudgetDowngraded ? 1 : 0);
+	RagdollBudgetLevel previousLevel = m_eBudgetLevel;
+	m_eBudgetLevel = level;
+
+	//A frozen ragdoll skips FinishSeedUpdate, so it would never settle: report it here.
+	//Only when the skeleton didn't do so itself, and last, the listener may bake us.
+	if(m_pSettleListener != nullptr && !m_pPhysxSkeleton->IsSettled())
+	{
+		if(level == RagdollBudgetLevel::BudgetFrozen)
+			m_pSettleListener->OnRagdollSettled(this);
+		else if(previousLevel == RagdollBudgetLevel::BudgetFrozen)
+			m_pSettleListener->OnRagdollWoken(this);
+	}
+}
+
+void PhysicsAnimator::ResetBudgetLevel()
+{
+	if(m_eBudgetLevel == RagdollBudgetLevel::BudgetSimulated)
+		return;
+
+	if(m_pPhysxSkeleton != nullptr)
+		m_pPhysxSkeleton->SetSolverIterations(0);
+	m_eBudgetLevel = RagdollBudgetLevel::BudgetSimulated;
+}
+
+void PhysicsAnimator::CreateBakedCollider()
+{
+	if(m_pPhysxSkeleton == nullptr || m_pPhysxSkeleton->GetAmountOfBones() == 0)
+		return;
+
+	//A box around the actors, padded with the thickness of a bone
+	const float padding = 0.3f;
+	NxVec3 minimum(FLT_MAX, FLT_MAX, FLT_MAX), maximum(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for(UINT slot=0; slot < m_pPhysxSkeleton->GetAmountOfBones(); ++slot)
+	{
+		const D3DXMATRIX& matActor = m_pPhysxSkeleton->GetActorWorldSpaceTransform(slot);
+		NxVec3 position(matActor._41, matActor._42, matActor._43);
+		minimum.min(position);
+		maximum.max(position);
+	}
+
+	NxBoxShapeDesc boxDesc;
+	boxDesc.dimensions = (maximum - minimum) * 0.5f + NxVec3(padding, padding, padding);
+	boxDesc.group = m_nxPhysxGroup;
+
+	//No body, so it's a static actor
+	NxActorDesc actorDesc;
+	actorDesc.shapes.pushBack(&boxDesc);
+	actorDesc.globalPose.t = (minimum + maximum) * 0.5f;
+	actorDesc.name = RAGDOLL_BAKED_COLLIDER_NAME;
+
+	ASSERT(!RagdollPosePipeline::GetInstance()->IsEnabled(), _T("PhysicsAnimator: baking creates an actor while PhysX simulates, not supported with the RagdollPosePipeline!"));
+	m_pBakedCollider = m_pPhysicsScene->createActor(actorDesc);
+	if(m_pBakedCollider == nullptr)
+		Logger::Log(_T("PhysicsAnimator: Error creating the collider of a baked ragdoll"), LogLevel::Warning);
+}
+
+void PhysicsAnimator::ReleaseBakedCollider()
+{
+	if(m_pBakedCollider != nullptr)
+		RagdollReleaseQueue::GetInstance()->QueueRelease(m_pPhysicsScene, m_pBakedCollider);
+	m_pBakedCollider = nullptr;
+}
+
+void PhysicsAnimator::MoveBakedCollider(NxScene* pScene)
+{
+	if(m_pBakedCollider == nullptr)
+		return;
+
+	NxBoxShapeDesc boxDesc;
+	m_pBakedCollider->getShapes()[0]->isBox()->saveToDesc(boxDesc);
+	NxActorDesc actorDesc;
+	actorDesc.shapes.pushBack(&boxDesc);
+	actorDesc.globalPose = m_pBakedCollider->getGlobalPose();
+	actorDesc.name = RAGDOLL_BAKED_COLLIDER_NAME;
+
+	//Released in the scene it is in now
+	ReleaseBakedCollider();
+	m_pBakedCollider = pScene->createActor(actorDesc);
+	if(m_pBakedCollider == nullptr)
+		Logger::Log(_T("PhysicsAnimator: Error moving the collider of a baked ragdoll"), LogLevel::Warning);
+}
+
+bool PhysicsAnimator::IsBakedCollider(const NxActor* pActor)
+{
+	return pActor != nullptr && pActor->getName() == RAGDOLL_BAKED_COLLIDER_NAME;
+}
+
+bool PhysicsAnimator::MoveToScene(NxScene* pScene)
+{
+	if(pScene == nullptr || pScene == m_pPhysicsScene)
+		return false;
+	//The limb hangs from the kinematic part, it goes back first
+	if(HasActiveRegion())
+		return false;
+
+	MoveBakedCollider(pScene);
+
+	//A falling ragdoll keeps its momentum. The pose is in the pose buffer already.
+	const bool isSimulating = (m_currentRagdollState == RagdollState::SeedState && m_pPhysxSkeleton != nullptr);
+	vector<NxVec3> velocities;
+	if(isSimulating)
+	{
+		for(auto pActor : m_pPhysxSkeleton->GetBoneActors())
+		{
+			velocities.push_back(pActor->getLinearVelocity());
+			velocities.push_back(pActor->getAngularVelocity());
+		}
+	}
+
+	//Both go back to the pool of the old scene, the new ones come from the pool of the new scene
+	const bool hadProxy = (m_pLeechProxy != nullptr);
+	const bool hadSkeleton = (m_pPhysxSkeleton != nullptr);
+	const float simulatedTime = m_fSimulatedTime;
+	ReleaseSkeleton();
+	ReleaseLeechProxy();
+	m_pPhysicsScene = pScene;
+
+	if(isSimulating)
+	{
+		//Seeded from the pose buffer, with joints, dynamic and awake
+		PrepareForSeed();
+		m_fSimulatedTime = simulatedTime;
+		if(m_pPhysxSkeleton != nullptr)
+		{
+			ArrayView<NxActor* const> actors = m_pPhysxSkeleton->GetBoneActors();
+			for(UINT slot=0; slot < actors.size() && slot * 2 + 1 < velocities.size(); ++slot)
+			{
+				RagdollCommandBuffer::GetInstance()->SetLinearVelocity(actors[slot], velocities[slot * 2], m_pPhysxSkeleton);
+				RagdollCommandBuffer::GetInstance()->SetAngularVelocity(actors[slot], velocities[slot * 2 + 1], m_pPhysxSkeleton);
+			}
+		}
+	}
+	else
+	{
+		if(hadProxy)
+			AcquireLeechProxy();
+		if(hadSkeleton)
+			AcquireSkeleton();
+	}
+
+	if(m_pSettleListener != nullptr)
+		m_pSettleListener->OnRagdollMigrated(this);
+	return true;
+}
+
+bool PhysicsAnimator::GetActorPose(UINT slot, D3DXMATRIX& matWorldPose, NxVec3& linearVelocity) const
+{
+	if(m_pPhysxSkeleton != nullptr)
+	{
+		if(slot >= m_pPhysxSkeleton->GetAmountOfBones())
+			return false;
+
+		//Pipelined, PhysX may be simulating: the state of the last fetchResults
+		if(RagdollPosePipeline::GetInstance()->IsEnabled())
+		{
+			matWorldPose = m_pPhysxSkeleton->GetCapturedActorPose(slot);
+			linearVelocity = m_pPhysxSkeleton->GetCapturedLinearVelocity(slot);
+			return true;
+		}
+
+		NxActor* pActor = m_pPhysxSkeleton->GetBoneActors()[slot];
+		PhysicsManager::GetInstance()->NMatToDMat(matWorldPose, pActor->getGlobalPose());
+		linearVelocity = pActor->getLinearVelocity();
+		return true;
+	}
+
+	//No skeleton: the actor would be where the pose puts it, at rest. Baked that is the frozen pose,
+	//otherwise the animation (a proxy, or a knockdown still waiting in the transition queue).
+	if(m_pDefinition && slot < m_pDefinition->GetAmountOfBones())
+	{
+		const D3DXMATRIX& matBone = m_bBaked ? m_FrozenBoneTransforms[m_pDefinition->GetBoneIndices()[slot]]
+			: m_BoneTransforms[m_pDefinition->GetBoneIndices()[slot]];
+		matWorldPose = m_pDefinition->GetTotalOffsets()[slot] * matBone * m_matWorldTransform;
+		linearVelocity = NxVec3(0,0,0);
+		return true;
+	}
+
+	return false;
+}
+
+void PhysicsAnimator::RequestLeechSync()
+{
+	if(m_pPhysxSkeleton != nullptr && m_currentRagdollState == RagdollState::LeechState)
+		m_pPhysxSkeleton->RequestLeechSync();
+}
+
+void PhysicsAnimator::SyncLeechPoses()
+{
+	//In SeedState the actors are the source, nothing to sync
+	if(m_currentRagdollState != RagdollState::LeechState)
+		return;
+
+	UpdateLeechProxy();
+	if(m_pPhysxSkeleton != nullptr)
+		m_pPhysxSkeleton->SyncLeechPoses();
+}
+
+void PhysicsAnimator::FeedBoneTransforms(ArrayView<const D3DXMATRIX> boneTransforms)
+{
+	//Nothing to do if the animation wrote in our buffer directly
+	if(boneTransforms.GetData() == m_BoneTransforms.GetData())
+		return;
+
+	ASSERT(boneTransforms.size() == m_BoneTransforms.GetSize(), _T("Amount of bone transforms does not match the skeleton!"));
+	UINT amount = min(boneTransforms.size(), m_BoneTransforms.GetSize());
+	if(amount > 0)
+		memcpy(m_BoneTransforms.GetData(), boneTransforms.GetData(), sizeof(D3DXMATRIX) * amount);
 }
 
 void PhysicsAnimator::PrepareForLeech()
 {
+	//Back to the proxy. The skeleton goes back to the pool, parking it releases its joints.
+	if(m_bUseLeechProxy && m_pDefinition)
+	{
+		ReleaseSkeleton();
+		ApplyLod();
+		AcquireLeechProxy();
+		return;
+	}
+
+	//A LOD switch asked for during SeedState. The new skeleton comes from the pool in LeechState.
+	ApplyLod();
+	//A baked ragdoll has no skeleton anymore
+	AcquireSkeleton();
+
 	if(m_pPhysxSkeleton == nullptr)
 		return;
 
+	m_pPhysxSkeleton->ResetSettleState();
 	for(auto physxBone : m_pPhysxSkeleton->GetPhysxBones())
 	{
 		//Set all actors kinematic
@@ -367,17 +714,30 @@ void PhysicsAnimator::PrepareForLeech()
 		physxBone->RaiseActorFlag(NX_AF_DISABLE_COLLISION);
 	}
 
-	//Delete all joints
-	//m_pPhysxSkeleton->ReleaseJoints();
+	//The joints are released after a while in LeechState, see UpdateLeechMode
+	m_fJointReleaseTimer = m_fJointReleaseDelay;
 }
 
 void PhysicsAnimator::PrepareForSeed()
 {
+	//With the proxy we don't have a skeleton yet, take one from the pool (or build it)
+	AcquireSkeleton();
+	ReleaseLeechProxy();
 	if(m_pPhysxSkeleton == nullptr)
 		return;
 
-	//Create all proper joints between the PhysxBones
-	//m_pPhysxSkeleton->CreateJoints();
+	//The actors only follow the animation on demand, so bring them up to date before they go dynamic.
+	//A skeleton fresh from the pool is seeded from the current animation pose this way.
+	//The actors of an active region are skipped, they go on from their simulated pose.
+	m_pPhysxSkeleton->SyncLeechPoses();
+	m_pPhysxSkeleton->DeactivateRegion(false);
+	m_fRegionTimer = -1.0f;
+
+	//Create all proper joints between the PhysxBones, if we don't have them anymore.
+	//The frames are precalculated, so it doesn't matter what pose the actors are in.
+	if(!m_pPhysxSkeleton->HasJoints())
+		m_pPhysxSkeleton->CreateJoints();
+	m_fSimulatedTime = 0.0f;
 
 	for(auto physxBone : m_pPhysxSkeleton->GetPhysxBones())
 	{
@@ -386,23 +746,69 @@ void PhysicsAnimator::PrepareForSeed()
 
 		//Enable collision detection for all actor
 		physxBone->ClearActorFlag(NX_AF_DISABLE_COLLISION);
+
+		//A pooled skeleton can still be sleeping from its last owner
+		RagdollCommandBuffer::GetInstance()->WakeUp(physxBone->GetActor(), m_pPhysxSkeleton);
+	}
+	m_pPhysxSkeleton->ResetSettleState();
+}
+
+void PhysicsAnimator::SetCurrentState(RagdollState state, bool immediate)
+{
+	m_requestedRagdollState = state;
+
+	//Back to the current state before our turn came, the queue skips us
+	if(m_currentRagdollState == state)
+		return;
+
+	//Without the queue every change is immediate
+	if(immediate || !RagdollTransitionQueue::GetInstance()->IsEnabled())
+	{
+		ChangeState();
+		return;
+	}
+
+	//Only once in the queue, the latest request counts
+	if(!m_bTransitionQueued)
+	{
+		m_bTransitionQueued = true;
+		RagdollTransitionQueue::GetInstance()->Queue(this);
 	}
 }
 
-void PhysicsAnimator::SetCurrentState(RagdollState state)
+bool PhysicsAnimator::ApplyQueuedState()
+{
+	m_bTransitionQueued = false;
+	return ChangeState();
+}
+
+bool PhysicsAnimator::ChangeState()
 {
 	//store the state if it is not allready the current state
 	//else return so we won't prepare anything again
-	if(m_currentRagdollState != state)
-		m_currentRagdollState = state;
+	if(m_currentRagdollState != m_requestedRagdollState)
+		m_currentRagdollState = m_requestedRagdollState;
 	else
-		return;
+		return false;
+
+	//Leaving SeedState, the frozen pose is of no use anymore.
+	//PrepareForLeech/Seed set the body flags, only the solver iterations need a reset.
+	if(m_bBaked)
+	{
+		m_bBaked = false;
+		ReleaseBakedCollider();
+	}
+	ResetBudgetLevel();
 
 	//prepare the skeleton based on the new state
 	if(m_currentRagdollState == RagdollState::LeechState)
 		PrepareForLeech();
 	else if(m_currentRagdollState == RagdollState::SeedState)
 		PrepareForSeed();
+
+	if(m_pSettleListener != nullptr)
+		m_pSettleListener->OnRagdollStateChanged(this, m_currentRagdollState);
+	return true;
 }
 
 void PhysicsAnimator::SetWorldTransform(const D3DXMATRIX& worldTransform)
@@ -415,6 +821,14 @@ void PhysicsAnimator::SetWorldTransform(const D3DXMATRIX& worldTransform)
 		m_pPhysxSkeleton->SetWorldTransform(m_matWorldTransform);
 }
 
+bool PhysicsAnimator::IsSettled() const
+{
+	//A baked ragdoll settled before it was baked, a frozen one is held where it is
+	return m_currentRagdollState == RagdollState::SeedState
+		&& (m_bBaked || m_eBudgetLevel == RagdollBudgetLevel::BudgetFrozen
+			|| (m_pPhysxSkeleton != nullptr && m_pPhysxSkeleton->IsSettled()));
+}
+
 PhysxSkeleton* PhysicsAnimator::GetSkeleton() const
 {
 	if(m_pPhysxSkeleton != nullptr)
@@ -10,12 +10,29 @@
 #include "../../../OverlordEngine/Helpers/GeneralStructs.h"
 #include "../../../OverlordEngine/OverlordComponents.h"
 
-#include "../../SZS_Tools/PugiXML/pugixml.hpp"
-
 #include "RagdollHelper.h"
 #include "PhysxSkeleton.h"
+#include "RagdollDefinition.h"
+#include "AlignedBuffer.h"
+#include "ArrayView.h"
 #include <vector>
 
+class RagdollProxy;
+class PhysicsAnimator;
+
+//Gets told when the ragdoll of an animator comes to rest or starts moving again (SeedState),
+//and when a (queued) state change actually happens
+class RagdollSettleListener
+{
+public:
+	virtual ~RagdollSettleListener(void) {};
+	virtual void OnRagdollSettled(PhysicsAnimator* pAnimator) = 0;
+	virtual void OnRagdollWoken(PhysicsAnimator* pAnimator) = 0;
+	virtual void OnRagdollStateChanged(PhysicsAnimator* pAnimator, RagdollState state) {};
+	//The ragdoll moved to another PhysX scene (see RagdollSceneShards), its actors are new
+	virtual void OnRagdollMigrated(PhysicsAnimator* pAnimator) {};
+};
+
 class PhysicsAnimator final
 {
 public:
@@ -23,32 +40,117 @@ public:
 	~PhysicsAnimator(void);
 
 	//METHODS
-	//Creates the ragdoll skeleton
+	//Creates the ragdoll skeleton (the humanoid, with its LOD tiers)
 	void BuildPhysicsSkeleton(PhysicsGroup group);
 	void BuildPhysicsSkeletonFromFile(PhysicsGroup group);
+	//Creates the ragdoll skeleton from a shared definition (see RagdollDefinitionCache), without LOD tiers
+	void BuildPhysicsSkeleton(const std::shared_ptr<const RagdollDefinition>& pDefinition, PhysicsGroup group);
 
 	//Calculate the bones transforms in LeechMode (DirectX model -> PhysX)
 	void UpdateLeechMode(GameContext& context);
 	//Calculate the bones transform in SeedMode (PhysX -> DirectX model)
 	void UpdateSeedMode(GameContext& context);
+	//While the RagdollUpdateBatch is enabled the skeleton isn't updated by the two above, but
+	//queued in the batch. The batch calls these after it updated all skeletons.
+	void FinishLeechUpdate(float deltaTime);
+	void FinishSeedUpdate(float deltaTime);
+	//LeechState only: the actors follow the animation on demand. Request a sync for this
+	//frame (eg. while a force field overlaps us) or sync right now (before a raycast or a save).
+	void RequestLeechSync();
+	void SyncLeechPoses();
+	//LeechState only: a hit reaction. The subtree of the ragdoll starting at this bone goes
+	//dynamic for the duration (negative == until DeactivateRegion), the rest keeps following
+	//the animation. With the proxy enabled the skeleton is taken from the pool for it.
+	bool ActivateRegion(UINT slot, float duration);
+	bool ActivateRegion(BoneNameId rootBone, float duration);
+	//Slot of the body nearest to this world position, in the pose of the pose buffer. The bodies
+	//don't have to exist (eg. a hit on the proxy). -1 without a definition.
+	int FindNearestSlot(const D3DXVECTOR3& worldPosition) const;
+	void DeactivateRegion();
+	bool HasActiveRegion() const {return m_pPhysxSkeleton != nullptr && m_pPhysxSkeleton->HasActiveRegion();};
+	//SeedState only: freezes the current pose and gives the skeleton back to the pool. We keep
+	//rendering the frozen pose. Optionally one static box stays behind to collide with.
+	bool Bake(bool keepCollider = false);
+	//Brings the skeleton back, from the frozen pose (eg. when something wants to push the ragdoll)
+	void Unbake();
+	//Moves the ragdoll to another PhysX scene (see RagdollSceneShards): the skeleton or proxy is
+	//swapped for one from the pool of that scene. A falling ragdoll takes its pose and velocities
+	//along. Not while a region is active. Game thread, nothing may be simulating.
+	bool MoveToScene(NxScene* pScene);
 
 	//SETTERS
-	//Sets the bone transforms
-	void FeedBoneTransforms(vector<D3DXMATRIX> boneTransforms){m_BoneOriginalTransforms = boneTransforms;};
-	//Sets our state
-	void SetCurrentState(RagdollState state);
+	//Sets the bone transforms. Only copies when the transforms were not written in the
+	//pose buffer directly (see GetBoneTransformBuffer).
+	void FeedBoneTransforms(ArrayView<const D3DXMATRIX> boneTransforms);
+	//Requests our state. While the RagdollTransitionQueue is enabled the change waits for its turn there,
+	//until then we stay in the current state (the animation keeps driving a ragdoll that waits for SeedState).
+	//Immediate skips the queue (eg. loading a save).
+	void SetCurrentState(RagdollState state, bool immediate = false);
+	//Called by the RagdollTransitionQueue. Returns false if there was nothing to change.
+	bool ApplyQueuedState();
 	//Sets the worldTransform of our owner object (the object we resemble)
 	void SetWorldTransform(const D3DXMATRIX& worldTransform);
+	//Time (seconds) the joints stay alive after going back to LeechState, so a quick
+	//knockdown after recovering doesn't recreate them. Negative keeps them forever.
+	void SetJointReleaseDelay(float seconds){m_fJointReleaseDelay = seconds;};
+	//With the proxy enabled the ragdoll is a single pooled capsule in LeechState. The full
+	//skeleton is only taken from the pool when going to SeedState, seeded from the animation.
+	void SetLeechProxyEnabled(bool enabled);
+	//Who to tell about settled/woken ragdolls, nullptr for nobody
+	void SetSettleListener(RagdollSettleListener* pListener){m_pSettleListener = pListener;};
+	//Switches the physics LOD tier. Only possible in LeechState, in SeedState the switch
+	//waits until we are back. Ignored if the definition has no tiers.
+	void SetLod(RagdollLod lod);
+	//How much the ragdoll matters to the RagdollBudget, reported by the owner every frame
+	void SetBudgetPriority(float distance, bool isImportant)
+	{
+		m_fBudgetDistance = distance;
+		m_bBudgetImportant = isImportant;
+	};
+	//Set by the RagdollBudget. Only has effect in SeedState, going to another state resets it.
+	void SetBudgetLevel(RagdollBudgetLevel level);
 
 	//GETTERS
+	//The pose buffer shared by the ModelComponent, this animator and the skeleton.
+	//The animation writes its bone transforms in here, in SeedState the ragdoll
+	//bones are overwritten with the PhysX result.
+	ArrayView<D3DXMATRIX> GetBoneTransformBuffer() {return ArrayView<D3DXMATRIX>(m_BoneTransforms.GetData(), m_BoneTransforms.GetSize());};
 	//Return the bone transforms
-	vector<D3DXMATRIX> SeedBoneTransforms() const {return m_BonePhysicsTransforms;};
+	ArrayView<const D3DXMATRIX> SeedBoneTransforms() const {return ArrayView<const D3DXMATRIX>(m_BoneTransforms.GetData(), m_BoneTransforms.GetSize());};
 	//Get our current state
 	const RagdollState GetCurrentState() const {return m_currentRagdollState;};
+	//Get the state we want to be in, differs from the current state while queued
+	const RagdollState GetRequestedState() const {return m_requestedRagdollState;};
+	//True when the ragdoll came to rest in SeedState and its actors are sleeping.
+	//A ragdoll frozen by the budget doesn't move anymore, it counts as settled.
+	bool IsSettled() const;
+	//True when the ragdoll is baked (no actors, frozen pose)
+	bool IsBaked() const {return m_bBaked;};
+	//World pose and velocity of the actor in this slot, also when the ragdoll is baked or has no skeleton yet
+	bool GetActorPose(UINT slot, D3DXMATRIX& matWorldPose, NxVec3& linearVelocity) const;
+	//The PhysX scene our actors live in
+	NxScene* GetPhysicsScene() const {return m_pPhysicsScene;};
+	const D3DXMATRIX& GetWorldTransform() const {return m_matWorldTransform;};
+	//True for the static box left behind by a baked ragdoll
+	static bool IsBakedCollider(const NxActor* pActor);
 	//Returns the pointer of the modelcompenent owning this animator
 	ModelComponent* GetOwnerModelComponent() const {return m_pOwnerModelComponent;};
-	//Returns all actors of the skeleton used by this Animator
+	//Returns all actors of the skeleton used by this Animator.
+	//nullptr in LeechState when the proxy is enabled!
 	PhysxSkeleton* GetSkeleton() const;
+	//Returns the proxy standing in for the skeleton, nullptr if there is none
+	RagdollProxy* GetLeechProxy() const {return m_pLeechProxy;};
+	bool IsLeechProxyEnabled() const {return m_bUseLeechProxy;};
+	//Returns the definition the skeleton is built from
+	const RagdollDefinition* GetDefinition() const {return m_pDefinition.get();};
+	//Returns the LOD tier in use
+	RagdollLod GetLod() const {return m_pDefinition ? m_pDefinition->GetLod() : RagdollLod::LodFull;};
+	//Budget information (see RagdollBudget)
+	RagdollBudgetLevel GetBudgetLevel() const {return m_eBudgetLevel;};
+	float GetBudgetDistance() const {return m_fBudgetDistance;};
+	bool IsBudgetImportant() const {return m_bBudgetImportant;};
+	//Seconds simulated since the last time we went to SeedState or got woken
+	float GetSimulatedTime() const {return m_fSimulatedTime;};
 	//Returns the position of the root actor
 	//NxVec3 GetRootActorPosition();
 
@@ -56,18 +158,75 @@ private:
 	//DATAMEMBERS
 	NxScene* m_pPhysicsScene;
 	MeshFilter* m_pMeshFilter;
-	vector<D3DXMATRIX> m_BoneOriginalTransforms;
-	vector<D3DXMATRIX> m_BonePhysicsTransforms;
+	AlignedBuffer<D3DXMATRIX> m_BoneTransforms; //The single pose buffer of our owner
 	D3DXMATRIX m_matWorldTransform;
 
 	PhysxSkeleton* m_pPhysxSkeleton;
 	RagdollState m_currentRagdollState;
+	RagdollState m_requestedRagdollState;
+	bool m_bTransitionQueued; //We are in the RagdollTransitionQueue
+
+	//What to take from the pool when the skeleton or proxy is needed
+	std::shared_ptr<const RagdollDefinition> m_pDefinition;
+	PhysicsGroup m_nxPhysxGroup;
+
+	//The definition of every LOD tier (nullptr if there is no such tier) and the tier we want
+	std::shared_ptr<const RagdollDefinition> m_pLodDefinitions[RagdollLod::LodCount];
+	RagdollLod m_eTargetLod;
+
+	RagdollSettleListener* m_pSettleListener;
+
+	//Baked ragdoll: the frozen pose and the optional static collider left behind
+	bool m_bBaked;
+	AlignedBuffer<D3DXMATRIX> m_FrozenBoneTransforms;
+	NxActor* m_pBakedCollider;
+
+	//Budget: what we are allowed and what decides it. A frozen ragdoll holds its pose
+	//in the frozen pose buffer as well.
+	RagdollBudgetLevel m_eBudgetLevel;
+	float m_fBudgetDistance;
+	bool m_bBudgetImportant;
+	float m_fSimulatedTime;
+
+	//Single actor standing in for the skeleton in LeechState
+	RagdollProxy* m_pLeechProxy;
+	bool m_bUseLeechProxy;
+
+	//Joints are created on the first SeedState and released after some time in LeechState
+	float m_fJointReleaseDelay;
+	float m_fJointReleaseTimer;
+
+	//Time left for the active region, negative keeps it
+	float m_fRegionTimer;
+
+	//We are in the RagdollUpdateBatch
+	bool m_bBatchQueued;
 
 	ModelComponent* m_pOwnerModelComponent;
 
 	//METHODS
 	void PrepareForLeech();
 	void PrepareForSeed();
+	//Goes to the requested state. Returns false if we are in it already.
+	bool ChangeState();
+	//Take the skeleton or proxy from the pool, or give it back
+	void AcquireSkeleton();
+	void ReleaseSkeleton();
+	void AcquireLeechProxy();
+	void ReleaseLeechProxy();
+	//Moves the proxy to the root of the animation
+	void UpdateLeechProxy();
+	//Builds from the definition of the target tier
+	void BuildFromDefinition(const std::shared_ptr<const RagdollDefinition>& pDefinition, PhysicsGroup group);
+	//Swaps the skeleton or proxy for the one of the target tier (LeechState only)
+	void ApplyLod();
+	//The static box around the baked ragdoll
+	void CreateBakedCollider();
+	void ReleaseBakedCollider();
+	//Same box, in another scene
+	void MoveBakedCollider(NxScene* pScene);
+	//Back to a fully simulated skeleton, without touching the body flags
+	void ResetBudgetLevel();
 
 	// -------------------------
 	// Disabling default copy constructor and default 
@@ -4,110 +4,86 @@
 //--------------------------------------------------------------------------------------
 #include "PhysxBone.h"
 #include "../Ragdolls/PhysxSkeleton.h"
+#include "../Ragdolls/RagdollReleaseQueue.h"
+#include "../Ragdolls/RagdollCommandBuffer.h"
 #include "../../../OverlordEngine/Managers/PhysicsManager.h"
 #include "../../../OverlordEngine/Diagnostics/Logger.h"
 
-PhysxBone::PhysxBone(NxScene* pScene, const PhysxBoneLayout& boneLayout, PhysxSkeleton* pOwnerSkeleton):
-	m_boneLayout(boneLayout),
+PhysxBone::PhysxBone(NxScene* pScene, const RagdollBoneRecord& boneRecord, PhysxSkeleton* pOwnerSkeleton, UINT slot):
+	m_pBoneRecord(&boneRecord),
 	m_pActor(nullptr),
-	m_pBone(nullptr),
-	m_iBoneIndex(-1),
+	m_iSlot(slot),
 	m_pPhysicsScene(pScene),
 	m_pOwnerSkeleton(pOwnerSkeleton),
 	debugValue(0.123456789f)
 {
-	D3DXMatrixIdentity(&m_matTotalOffset);
-	D3DXMatrixIdentity(&m_matModelWorldSpace);
-	D3DXMatrixIdentity(&m_matActorWorldSpace);
-	D3DXMatrixIdentity(&m_matActorToModelTransform);
 }
 
 PhysxBone::~PhysxBone(void)
 {
+	//Released later, under the budget of the release queue
 	if(m_pActor)
-		m_pPhysicsScene->releaseActor(*m_pActor);
+		RagdollReleaseQueue::GetInstance()->QueueRelease(m_pPhysicsScene, m_pActor);
+	m_pActor = nullptr;
 }
 
-void PhysxBone::Initiliaze(MeshFilter* pMeshFilter, PhysicsGroup group)
+void PhysxBone::Initiliaze(PhysicsGroup group, const D3DXMATRIX& matActorWorldSpace)
 {
-	//Map the bone
-	MapToBone(pMeshFilter);
 	//Create actor and set it on the correct position
-	CreatePhysxBone(pMeshFilter, group);
+	CreatePhysxBone(group, matActorWorldSpace);
 }
 
-void PhysxBone::MapToBone(MeshFilter* pMeshFilter)
+const int PhysxBone::GetIndex() const
 {
-	//Find the bone we want to map to
-	for(auto bone : pMeshFilter->GetSkeleton())
-	{
-		if(m_boneLayout.name == bone.Name)
-		{
-			m_pBone = &bone;
-			break;
-		}
-	}
-	//Check if we found our bone, else there is a mistake with the input
-	ASSERT(m_pBone!=nullptr, _T("PhysxBone NAME INCORRECT! PhysxBone can not be mapped to a Bone in the Model!"));
+	return m_pOwnerSkeleton->GetBoneIndex(m_iSlot);
+}
 
-	if(m_pBone)
-	{
-		//Store the index
-		m_iBoneIndex = m_pBone->Index;
+const D3DXMATRIX PhysxBone::GetActorInModelSpaceTransform() const
+{
+	return m_pOwnerSkeleton->GetActorModelSpaceTransform(m_iSlot);
+}
 
-		//Create matrix that converts the offsetOrientation from PhysX to Max axis
-		//PhysX: 0,0,0 rotation == capsule pointing up
-		//Max: 0,0,0 rotation == capsule pointing right
-		D3DXMATRIX matOrientationMaxToPhysx;
-		D3DXMatrixIdentity(&matOrientationMaxToPhysx);
-		D3DXMatrixRotationYawPitchRoll(&matOrientationMaxToPhysx, 0.0f, 0.0f, (float)D3DXToRadian(-90.0f));
+const D3DXMATRIX PhysxBone::GetActorInWorldSpaceTransform() const
+{
+	return m_pOwnerSkeleton->GetActorWorldSpaceTransform(m_iSlot);
+}
 
-		//So the total offset equals rotating the bone like in max and offset it with the data from max
-		m_matTotalOffset = matOrientationMaxToPhysx * m_pBone->Offset;
+const D3DXMATRIX PhysxBone::GetActorOffset() const
+{
+	return m_pOwnerSkeleton->GetActorOffset(m_iSlot);
+}
 
-		//Calculate the position of the bone in worldspace (Bind-Pose)
-		m_matActorWorldSpace = m_matTotalOffset * m_matModelWorldSpace;
-	}
+void PhysxBone::RaiseBodyFlag(NxBodyFlag flag)
+{
+	RagdollCommandBuffer::GetInstance()->RaiseBodyFlag(m_pActor, flag, m_pOwnerSkeleton);
 }
 
-void PhysxBone::UpdateLeechMode(const D3DXMATRIX& matKeyTransform)
+void PhysxBone::ClearBodyFlag(NxBodyFlag flag)
 {
-	//Calculate the position of the bone using following formula
-	//boneOffset * boneAnimTransform * worldTransformModel
-	m_matActorWorldSpace = m_matTotalOffset * matKeyTransform * m_matModelWorldSpace;
+	RagdollCommandBuffer::GetInstance()->ClearBodyFlag(m_pActor, flag, m_pOwnerSkeleton);
+}
 
-	NxMat34 nPos;
-	PhysicsManager::GetInstance()->DMatToNMat(nPos, m_matActorWorldSpace);
-	m_pActor->setGlobalPose(nPos);
+void PhysxBone::RaiseActorFlag(NxActorFlag flag)
+{
+	RagdollCommandBuffer::GetInstance()->RaiseActorFlag(m_pActor, flag, m_pOwnerSkeleton);
 }
 
-void PhysxBone::UpdateSeedMode()
+void PhysxBone::ClearActorFlag(NxActorFlag flag)
 {
-	//Transform the actor back in model space after the simul of PhysX
-	//Get our actor position and convert it
-	D3DXMATRIX actorWorldSpace, totalOffsetInverse, modelWorldSpaceInverse;
-	NxMat34 actorPhysxWorldSpace =  m_pActor->getGlobalPose();
-
-	PhysicsManager::GetInstance()->NMatToDMat(actorWorldSpace, actorPhysxWorldSpace);
-	//Get the inverse matrices of the matrices we used to position our actor
-	D3DXMatrixInverse(&totalOffsetInverse, NULL, &m_matTotalOffset);
-	D3DXMatrixInverse(&modelWorldSpaceInverse, NULL, &m_matModelWorldSpace);
-
-	//Calculate our final position by using inverse matrix of our offset
-	m_matActorToModelTransform = totalOffsetInverse * actorWorldSpace * modelWorldSpaceInverse;
+	RagdollCommandBuffer::GetInstance()->ClearActorFlag(m_pActor, flag, m_pOwnerSkeleton);
 }
 
-void PhysxBone::CreatePhysxBone(MeshFilter* pMeshFilter, PhysicsGroup group)
+void PhysxBone::CreatePhysxBone(PhysicsGroup group, const D3DXMATRIX& matActorWorldSpace)
 {
 	//Creates the bone using the information we know when we mapped the bone
 	//Also taking into account which shape we want
-	if(m_boneLayout.shapeType == RagdollShapeType::capsule)
+	if((RagdollShapeType)m_pBoneRecord->shapeType == RagdollShapeType::capsule)
 	{
 		//Create the capsule shape desc
 		NxCapsuleShapeDesc capsuleDesc;
 		capsuleDesc.setToDefault();
-		capsuleDesc.height = m_boneLayout.height;
-		capsuleDesc.radius = m_boneLayout.radius;
+		capsuleDesc.height = m_pBoneRecord->height;
+		capsuleDesc.radius = m_pBoneRecord->radius;
 		capsuleDesc.localPose.t = NxVec3(0, capsuleDesc.radius + 0.5f * capsuleDesc.height, 0);
 		capsuleDesc.group = group;
 
@@ -126,7 +102,7 @@ void PhysxBone::CreatePhysxBone(MeshFilter* pMeshFilter, PhysicsGroup group)
 
 		//Position the actor to the correct place
 		NxMat34 nPos;
-		PhysicsManager::GetInstance()->DMatToNMat(nPos, m_matActorWorldSpace);
+		PhysicsManager::GetInstance()->DMatToNMat(nPos, matActorWorldSpace);
 		actorDesc.globalPose = nPos;
 
 		//Create the actor
@@ -141,12 +117,12 @@ void PhysxBone::CreatePhysxBone(MeshFilter* pMeshFilter, PhysicsGroup group)
 		m_pActor->raiseBodyFlag(NX_BF_KINEMATIC);
 		m_pActor->raiseActorFlag(NX_AF_DISABLE_COLLISION);
 	}
-	else if(m_boneLayout.shapeType == RagdollShapeType::sphere)
+	else if((RagdollShapeType)m_pBoneRecord->shapeType == RagdollShapeType::sphere)
 	{	
 		//Create the sphere shape desc
 		NxSphereShapeDesc sphereDesc;
-		sphereDesc.radius = m_boneLayout.radius;
-		sphereDesc.localPose.t = NxVec3(0, m_boneLayout.radius, 0);
+		sphereDesc.radius = m_pBoneRecord->radius;
+		sphereDesc.localPose.t = NxVec3(0, m_pBoneRecord->radius, 0);
 		sphereDesc.group = group;
 
 		//Create body so the actor is dynamic
@@ -163,7 +139,7 @@ void PhysxBone::CreatePhysxBone(MeshFilter* pMeshFilter, PhysicsGroup group)
 
 		//Position the actor to the correct place
 		NxMat34 nPos;
-		PhysicsManager::GetInstance()->DMatToNMat(nPos, m_matActorWorldSpace);
+		PhysicsManager::GetInstance()->DMatToNMat(nPos, matActorWorldSpace);
 		actorDesc.globalPose = nPos;
 
 		//Create the actor
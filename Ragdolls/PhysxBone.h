@@ -9,6 +9,7 @@
 #include "../../../OverlordEngine/Helpers/D3DUtil.h"
 #include "../../../OverlordEngine/OverlordComponents.h"
 #include "../Ragdolls/RagdollHelper.h"
+#include "../Ragdolls/RagdollCookedFormat.h"
 #include <algorithm>
 #include <vector>
 
@@ -18,56 +19,47 @@ class PhysxBone final
 {
 public:
 	//Constructor and Destructor
-	PhysxBone(NxScene* pScene, const PhysxBoneLayout& boneLayout, PhysxSkeleton* pOwnerSkeleton);
+	PhysxBone(NxScene* pScene, const RagdollBoneRecord& boneRecord, PhysxSkeleton* pOwnerSkeleton, UINT slot);
 	~PhysxBone(void);
 
 	//METHODS
-	//Creates and maps the bone
-	void Initiliaze(MeshFilter* pMeshFilter, PhysicsGroup group);
-	//Update Bone
-	void UpdateLeechMode(const D3DXMATRIX& matKeyTransform);
-	void UpdateSeedMode();
+	//Creates the actor on the given position. The mapping to the mesh (offset, bone index)
+	//is done once in the RagdollDefinition, the bone itself only keeps the cold data.
+	void Initiliaze(PhysicsGroup group, const D3DXMATRIX& matActorWorldSpace);
 
 	//GETTERS
 	NxActor* GetActor() const {return m_pActor;};
-	const int GetIndex() const {return m_iBoneIndex;};
-	const PhysxBoneLayout GetBoneLayout() const {return m_boneLayout;};
-	const D3DXMATRIX GetActorInModelSpaceTransform() const {return m_matActorToModelTransform;};
-	const D3DXMATRIX GetActorInWorldSpaceTransform() const {return m_matModelWorldSpace;};
-	const D3DXMATRIX GetActorOffset() const {return m_matTotalOffset;};
+	//Slot of this bone in the arrays of the owning skeleton
+	UINT GetSlot() const {return m_iSlot;};
+	const int GetIndex() const;
+	const RagdollBoneRecord& GetBoneRecord() const {return *m_pBoneRecord;};
+	const D3DXMATRIX GetActorInModelSpaceTransform() const;
+	const D3DXMATRIX GetActorInWorldSpaceTransform() const;
+	const D3DXMATRIX GetActorOffset() const;
 	PhysxSkeleton* GetOwnerSkeleton() const {return m_pOwnerSkeleton;};
 	float GetDebugValue() const {return debugValue;};
 
 	//SETTERS
-	void SetModelWorldTransform(const D3DXMATRIX& worldTransform){m_matModelWorldSpace = worldTransform;};
-	void RaiseBodyFlag(NxBodyFlag flag){m_pActor->raiseBodyFlag(flag);};
-	void ClearBodyFlag(NxBodyFlag flag){m_pActor->clearBodyFlag(flag);};
-	void RaiseActorFlag(NxActorFlag flag){m_pActor->raiseActorFlag(flag);};
-	void ClearActorFlag(NxActorFlag flag){m_pActor->clearActorFlag(flag);};
+	//Through the RagdollCommandBuffer, so they can be applied later when it is recording
+	void RaiseBodyFlag(NxBodyFlag flag);
+	void ClearBodyFlag(NxBodyFlag flag);
+	void RaiseActorFlag(NxActorFlag flag);
+	void ClearActorFlag(NxActorFlag flag);
 
 private:
 	//DATAMEMBERS
-	PhysxBoneLayout m_boneLayout; //Layout of the bone
-
-	D3DXMATRIX m_matTotalOffset; //TotalOffset of the bone based on parents
-	D3DXMATRIX m_matModelWorldSpace; //The world space position of our model we are linked to
-	D3DXMATRIX m_matActorWorldSpace; //WorldSpace Position of the Actor itself
+	const RagdollBoneRecord* m_pBoneRecord; //Layout of the bone (in the blob of the RagdollDefinition)
 
 	NxActor* m_pActor; //The PhysX actor of this bone
-
-	Bone* m_pBone; //The bone we mapped to
-	int m_iBoneIndex; //The index of the bone we mapped to
+	UINT m_iSlot; //Slot of this bone in the hot arrays of the owning skeleton
 
 	NxScene* m_pPhysicsScene; //Pointer to our PhysXScene
 	PhysxSkeleton* m_pOwnerSkeleton; //Pointer to the Skeleton owning this bone
 
-	D3DXMATRIX m_matActorToModelTransform; //The matrix holding the actor's position in model space
-
 	float debugValue; //Temp used in contactreport to avoid calling non physxBone
 
 	//METHODS
-	void MapToBone(MeshFilter* pMeshFilter);
-	void CreatePhysxBone(MeshFilter* pMeshFilter, PhysicsGroup group);
+	void CreatePhysxBone(PhysicsGroup group, const D3DXMATRIX& matActorWorldSpace);
 
 	//Operators
 	// -------------------------
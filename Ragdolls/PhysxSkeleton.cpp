@@ -4,10 +4,34 @@
 //--------------------------------------------------------------------------------------
 #include "PhysxSkeleton.h"
 #include "../Ragdolls/PhysicsAnimator.h"
+#include "../Ragdolls/RagdollMath.h"
+#include "../Ragdolls/RagdollReleaseQueue.h"
+#include "../Ragdolls/RagdollLod.h"
+#include "../Ragdolls/RagdollJobSystem.h"
+#include "../Ragdolls/RagdollCommandBuffer.h"
+#include "../Ragdolls/RagdollPosePipeline.h"
 #include "../../../OverlordEngine/Managers/PhysicsManager.h"
 #include "../../../OverlordEngine/Diagnostics/Logger.h"
-
-PhysxSkeleton::PhysxSkeleton(NxScene* pScene, PhysicsGroup group,  PhysicsAnimator* ownerPhysicsAnimator):
+#include <algorithm>
+
+//Skeletons per job of the batch updates, a skeleton is only a few microseconds of math
+static const UINT RAGDOLL_SKELETONS_PER_JOB = 8;
+
+PhysxSkeleton::PhysxSkeleton(NxScene* pScene, PhysicsGroup group,  PhysicsAnimator* ownerPhysicsAnimator,
+	const std::shared_ptr<const RagdollDefinition>& pDefinition):
+	m_iJointGeneration(0),
+	m_pDefinition(pDefinition),
+	m_bLeechPosesStale(false),
+	m_bLeechSyncRequested(false),
+	m_bPushedPosesValid(false),
+	m_bSeedPulled(false),
+	m_iSnapshotFront(0),
+	m_iAmountSnapshots(0),
+	m_fTotalMass(0.0f),
+	m_fKineticEnergy(0.0f),
+	m_fSettleEnergy(0.05f), m_fWakeEnergy(0.5f), m_fSettleTime(0.5f),
+	m_fRestTime(0.0f),
+	m_bSettled(false),
 	m_pPhysicsScene(pScene),
 	m_nxPhysxGroup(group),
 	m_pOwnerPhysicsAnimator(ownerPhysicsAnimator)
@@ -16,25 +40,20 @@ PhysxSkeleton::PhysxSkeleton(NxScene* pScene, PhysicsGroup group,  PhysicsAnimat
 	//in the wrong place if no concrete worldtransform is given allready
 	D3DXMatrixIdentity(&m_matWorldTransform);
 
-	//Fill the transform vectors with identity matrices for the amount of bones present.
-	//We need to do this to ensure if someone would call this vector before we did any 
-	//any calculations. The amount of bones can't be fetched here directly, but we can
-	//ask for the transforms of the PhysxAnimator because it uses the same init principle
-	D3DXMATRIX identityMatrix;
-	D3DXMatrixIdentity(&identityMatrix);
+	//We don't own any bone transforms, we work in the pose buffer of the PhysxAnimator
 	if(m_pOwnerPhysicsAnimator != nullptr)
-	{
-		for(UINT i=0; i<m_pOwnerPhysicsAnimator->SeedBoneTransforms().size(); ++i)
-		{
-			m_BoneOriginalTransforms.push_back(identityMatrix);
-			m_BonePhysicsTransforms.push_back(identityMatrix);
-		}
-	}
+		m_BoneTransforms = m_pOwnerPhysicsAnimator->GetBoneTransformBuffer();
+
+	RagdollPosePipeline::GetInstance()->Register(this);
 }
 
 PhysxSkeleton::~PhysxSkeleton(void)
 {
-	//Release active joints when deleting this object
+	//Writes and joints still waiting for the flush would point at a dead skeleton
+	RagdollCommandBuffer::GetInstance()->Cancel(this);
+	RagdollPosePipeline::GetInstance()->Unregister(this);
+
+	//Queue the active joints for release, before the actors they connect
 	ReleaseJoints();
 
 	for(auto physxBone : m_vpPhysxBones)
@@ -42,57 +61,74 @@ PhysxSkeleton::~PhysxSkeleton(void)
 		SafeDelete(physxBone);
 	}
 	m_vpPhysxBones.clear();
-
-	m_vJointLayouts.clear();
+	m_vpBoneActors.clear();
 }
 
-void PhysxSkeleton::AddBone(const PhysxBoneLayout& boneLayout)
+PhysxBone* PhysxSkeleton::GetPhysxBone(BoneNameId nameId) const
 {
-	if(m_pPhysicsScene)
-		m_vpPhysxBones.push_back(new PhysxBone(m_pPhysicsScene, boneLayout, this));
-}
+	int slot = m_pDefinition->FindBoneSlot(nameId);
+	if(slot >= 0 && slot < (int)m_vpPhysxBones.size())
+		return m_vpPhysxBones[slot];
 
-PhysxBone* PhysxSkeleton::GetPhysxBone(const PhysxBoneLayout& boneLayout) const
-{
-	for(auto physxBone : m_vpPhysxBones)
-	{
-		if(physxBone->GetBoneLayout().name == boneLayout.name)
-			return physxBone;
-	}
-	//If we found no bone matching the layout, there is a mistake with the input
-	ASSERT(true, _T("PhysxBone does not exist!"));
+	//If we found no bone matching the name, there is a mistake with the input
+	ASSERT(false, _T("PhysxBone does not exist!"));
 	return nullptr;
 }
 
-vector<NxActor*> PhysxSkeleton::GetBoneActors() const
+PhysxBone* PhysxSkeleton::GetPhysxBone(const tstring& name) const
 {
-	vector<NxActor*> vBoneActors;
-	for(auto bone : m_vpPhysxBones)
-	{
-		vBoneActors.push_back(bone->GetActor());
-	}
-	return vBoneActors;
+	return GetPhysxBone(BoneNameTable::GetInstance()->Find(name));
 }
 
-void PhysxSkeleton::AddJoint(const PhysxJointLayout& jointLayout)
+PhysxBone* PhysxSkeleton::GetPhysxBoneOfMeshBone(int meshBoneIndex) const
 {
-	m_vJointLayouts.push_back(jointLayout);
+	int slot = m_pDefinition->GetSlotOfMeshBone(meshBoneIndex);
+	if(slot >= 0 && slot < (int)m_vpPhysxBones.size())
+		return m_vpPhysxBones[slot];
+	return nullptr;
 }
 
-void PhysxSkeleton::Initiliaze(MeshFilter* pMeshFilter)
+void PhysxSkeleton::Initiliaze()
 {
-	//First check if all the input is correct
-	//For n bones we need n-1 joints
-	int amountPhysxBones = m_vpPhysxBones.size();
-	int amountJoints = m_vJointLayouts.size() + 1;
-	if(amountPhysxBones != amountJoints)
-		ASSERT(true, _T("Can not construct correct skeleton! Mismatch amount of BoneLayouts and JointLayouts!"));
+	if(m_pPhysicsScene == nullptr || !m_pDefinition)
+		return;
 
-	//Creates and Maps all the bones
-	for(auto physxBone : m_vpPhysxBones)
+	//Allocate the hot arrays now we know the amount of bones
+	const UINT amountPhysxBones = m_pDefinition->GetAmountOfBones();
+	D3DXMATRIX identityMatrix;
+	D3DXMatrixIdentity(&identityMatrix);
+	m_matActorWorldPoses.Resize(amountPhysxBones);
+	m_matActorModelPoses.Resize(amountPhysxBones);
+	m_matActorModelPoses.Fill(identityMatrix);
+	m_matActorPushedPoses.Resize(amountPhysxBones);
+	m_RegionMask.Resize(amountPhysxBones);
+	m_RegionMask.Fill(0);
+	for(auto& snapshot : m_Snapshots)
+	{
+		snapshot.poses.Resize(amountPhysxBones);
+		snapshot.linearVelocities.Resize(amountPhysxBones);
+		snapshot.kineticEnergy = 0.0f;
+		snapshot.anyAwake = false;
+	}
+	InvalidateSnapshots();
+
+	//Creates all the bones, in the bind pose
+	const D3DXMATRIX* pTotalOffsets = m_pDefinition->GetTotalOffsets();
+	for(UINT slot=0; slot < amountPhysxBones; ++slot)
 	{
-		physxBone->Initiliaze(pMeshFilter, m_nxPhysxGroup);
+		m_matActorWorldPoses[slot] = pTotalOffsets[slot] * m_matWorldTransform;
+
+		PhysxBone* pPhysxBone = new PhysxBone(m_pPhysicsScene, m_pDefinition->GetBoneRecord(slot), this, slot);
+		pPhysxBone->Initiliaze(m_nxPhysxGroup, m_matActorWorldPoses[slot]);
+		m_vpPhysxBones.push_back(pPhysxBone);
+		m_vpBoneActors.push_back(pPhysxBone->GetActor());
+		m_matActorPushedPoses[slot] = m_matActorWorldPoses[slot];
+		m_fTotalMass += pPhysxBone->GetActor()->getMass();
 	}
+	m_bPushedPosesValid = true;
+
+	//Cheaper tiers get less solver iterations
+	SetSolverIterations(0);
 
 	//Get the root bone (first in vector) and lock if wanted
 	PhysxBone* rootBone = m_vpPhysxBones.at(0);
@@ -105,34 +141,412 @@ void PhysxSkeleton::Initiliaze(MeshFilter* pMeshFilter)
 
 void PhysxSkeleton::UpdateLeechMode(GameContext& context)
 {
-	//Updates all the bones
-	for(auto physxBone : m_vpPhysxBones)
+	if(HasActiveRegion())
 	{
-		//Pass the world transform of model to the bone to do the necessary calculations
-		physxBone->SetModelWorldTransform(m_matWorldTransform);
-		//Get our index
-		int i = physxBone->GetIndex();
-		//Feed transform so we can calculate the actor's position
-		physxBone->UpdateLeechMode(m_BoneOriginalTransforms.at(i));
+		UpdateRegion();
+		return;
 	}
+
+	//The animation moved on. Kinematic actors without collision can only be seen by
+	//queries, so only move them if someone asked for it.
+	m_bLeechPosesStale = true;
+	if(m_bLeechSyncRequested)
+		SyncLeechPoses();
+	m_bLeechSyncRequested = false;
 }
 
 void PhysxSkeleton::UpdateSeedMode(GameContext& context)
 {
-	//Copy the original local transforms before adjusting them
-	m_BonePhysicsTransforms = m_BoneOriginalTransforms;
+	//A settled ragdoll sleeps, nothing moves until PhysX wakes it. Its last pose still goes
+	//over the animation in the pose buffer.
+	if(m_bSettled && !IsAnyActorAwake())
+	{
+		WriteSeedPoses();
+		return;
+	}
 
-	//Updates all the bones
-	for(auto physxBone : m_vpPhysxBones)
+	PullSeedPoses();
+	CalculateSeedPoses();
+	WriteSeedPoses();
+}
+
+void PhysxSkeleton::UpdateLeechMode(PhysxSkeleton* const* ppSkeletons, UINT amountSkeletons)
+{
+	//Skeletons with an active region read and write every frame, they go on their own
+	for(UINT i=0; i < amountSkeletons; ++i)
+	{
+		if(ppSkeletons[i]->HasActiveRegion())
+			ppSkeletons[i]->UpdateRegion();
+	}
+
+	//First do the math for all requested skeletons (in parallel, every skeleton only touches
+	//its own arrays), then all the PhysX writes
+	RagdollJobSystem::GetInstance()->ParallelFor(amountSkeletons, RAGDOLL_SKELETONS_PER_JOB,
+		[ppSkeletons](UINT begin, UINT end)
+		{
+			for(UINT i=begin; i < end; ++i)
+			{
+				if(ppSkeletons[i]->HasActiveRegion())
+					continue;
+				ppSkeletons[i]->m_bLeechPosesStale = true;
+				if(ppSkeletons[i]->m_bLeechSyncRequested)
+				{
+					ppSkeletons[i]->CalculateLeechPoses();
+					ppSkeletons[i]->m_bLeechPosesStale = false;
+				}
+			}
+		});
+	for(UINT i=0; i < amountSkeletons; ++i)
+	{
+		if(ppSkeletons[i]->m_bLeechSyncRequested && !ppSkeletons[i]->HasActiveRegion())
+			ppSkeletons[i]->PushLeechPoses();
+		ppSkeletons[i]->m_bLeechSyncRequested = false;
+	}
+}
+
+void PhysxSkeleton::UpdateSeedMode(PhysxSkeleton* const* ppSkeletons, UINT amountSkeletons)
+{
+	//First do all the PhysX reads, then the math for all skeletons. Sleeping ones are skipped.
+	//Whether a skeleton sleeps is a PhysX read too, so it is decided here once.
+	//Pipelined, the reads are copies of the snapshots and go in the jobs as well.
+	const bool pipelined = RagdollPosePipeline::GetInstance()->IsEnabled();
+	const float interpolation = RagdollPosePipeline::GetInstance()->GetInterpolation();
+	for(UINT i=0; i < amountSkeletons; ++i)
+	{
+		PhysxSkeleton* pSkeleton = ppSkeletons[i];
+		pSkeleton->m_bSeedPulled = !pSkeleton->m_bSettled || pSkeleton->IsAnyActorAwake();
+		if(pSkeleton->m_bSeedPulled && !pipelined)
+			pSkeleton->PullSeedPoses();
+	}
+	RagdollJobSystem::GetInstance()->ParallelFor(amountSkeletons, RAGDOLL_SKELETONS_PER_JOB,
+		[ppSkeletons, pipelined, interpolation](UINT begin, UINT end)
+		{
+			for(UINT i=begin; i < end; ++i)
+			{
+				if(ppSkeletons[i]->m_bSeedPulled)
+				{
+					if(pipelined)
+						ppSkeletons[i]->CopySnapshotPoses(interpolation);
+					ppSkeletons[i]->CalculateSeedPoses();
+				}
+				ppSkeletons[i]->WriteSeedPoses();
+			}
+		});
+}
+
+void PhysxSkeleton::SyncLeechPoses()
+{
+	if(m_BoneTransforms.empty())
+		return;
+
+	if(m_bLeechPosesStale)
+	{
+		CalculateLeechPoses();
+		m_bLeechPosesStale = false;
+	}
+	PushLeechPoses();
+	//Teleported, a snapshot from before this would pull the actors back
+	InvalidateSnapshots();
+}
+
+void PhysxSkeleton::CalculateLeechPoses()
+{
+	//Known archetypes use the unrolled loops
+	switch(m_pDefinition->GetLayoutBones())
+	{
+	case HumanoidLayout::AmountOfBones:
+		CalculateLeechPosesFixed<HumanoidLayout::AmountOfBones>();
+		return;
+	case HumanoidReducedLayout::AmountOfBones:
+		CalculateLeechPosesFixed<HumanoidReducedLayout::AmountOfBones>();
+		return;
+	case HumanoidMinimalLayout::AmountOfBones:
+		CalculateLeechPosesFixed<HumanoidMinimalLayout::AmountOfBones>();
+		return;
+	}
+
+	//Calculate the position of all the bones using following formula
+	//boneOffset * boneAnimTransform * worldTransformModel
+	RagdollMath::LeechTransforms(m_pDefinition->GetTotalOffsets(), m_BoneTransforms.GetData(), m_pDefinition->GetBoneIndices(),
+		m_matWorldTransform, m_matActorWorldPoses.GetData(), m_matActorWorldPoses.GetSize());
+}
+
+void PhysxSkeleton::PushLeechPoses()
+{
+	//Push the results to PhysX in a separate pass so the math only touches the hot arrays.
+	//Actors whose pose didn't change since the last push are skipped, so are the dynamic ones of a region.
+	NxMat34 nPos;
+	for(UINT i=0; i < m_matActorWorldPoses.GetSize(); ++i)
+	{
+		if(m_RegionMask[i] != 0)
+			continue;
+		if(m_bPushedPosesValid && memcmp(&m_matActorWorldPoses[i], &m_matActorPushedPoses[i], sizeof(D3DXMATRIX)) == 0)
+			continue;
+
+		PhysicsManager::GetInstance()->DMatToNMat(nPos, m_matActorWorldPoses[i]);
+		RagdollCommandBuffer::GetInstance()->SetGlobalPose(m_vpBoneActors[i], nPos, this);
+		m_matActorPushedPoses[i] = m_matActorWorldPoses[i];
+	}
+	m_bPushedPosesValid = true;
+}
+
+void PhysxSkeleton::PullSeedPoses()
+{
+	if(RagdollPosePipeline::GetInstance()->IsEnabled())
+	{
+		CopySnapshotPoses(RagdollPosePipeline::GetInstance()->GetInterpolation());
+		return;
+	}
+
+	//The actors move by themselves now, the next leech push has to write all of them
+	m_bPushedPosesValid = false;
+
+	//Get our actor positions after the simul of PhysX and convert them.
+	//While we read the actors anyway, sum up their energy for the settle detection.
+	m_fKineticEnergy = 0.0f;
+	for(UINT i=0; i < m_matActorWorldPoses.GetSize(); ++i)
+	{
+		PhysicsManager::GetInstance()->NMatToDMat(m_matActorWorldPoses[i], m_vpBoneActors[i]->getGlobalPose());
+		m_fKineticEnergy += m_vpBoneActors[i]->computeKineticEnergy();
+	}
+}
+
+void PhysxSkeleton::CopySnapshotPoses(float interpolation)
+{
+	m_bPushedPosesValid = false;
+
+	//Nothing captured since we moved the actors: they are still where we put them, and count as moving
+	if(m_iAmountSnapshots == 0)
+	{
+		m_fKineticEnergy = m_fSettleEnergy * m_fTotalMass;
+		return;
+	}
+
+	const PoseSnapshot& snapshot = m_Snapshots[m_iSnapshotFront];
+	m_fKineticEnergy = snapshot.kineticEnergy;
+
+	//Fixed step: blend from the step before to the last one
+	if(m_iAmountSnapshots == 2 && interpolation < 1.0f)
+	{
+		RagdollMath::InterpolatePoses(m_Snapshots[1 - m_iSnapshotFront].poses.GetData(), snapshot.poses.GetData(),
+			interpolation, m_matActorWorldPoses.GetData(), m_matActorWorldPoses.GetSize());
+		return;
+	}
+	memcpy(m_matActorWorldPoses.GetData(), snapshot.poses.GetData(), sizeof(D3DXMATRIX) * m_matActorWorldPoses.GetSize());
+}
+
+void PhysxSkeleton::CapturePoses()
+{
+	bool anyAwake = false;
+	for(auto pActor : m_vpBoneActors)
+	{
+		if(!pActor->isSleeping())
+		{
+			anyAwake = true;
+			break;
+		}
+	}
+
+	//A sleeping ragdoll didn't move, the front snapshot still holds its pose.
+	//The one before it is older, so nothing to blend with anymore.
+	if(m_iAmountSnapshots > 0 && !anyAwake)
+	{
+		m_Snapshots[m_iSnapshotFront].anyAwake = false;
+		m_Snapshots[m_iSnapshotFront].kineticEnergy = 0.0f;
+		m_iAmountSnapshots = 1;
+		return;
+	}
+
+	//Write the back one, the front one stays intact until we flip
+	const UINT back = 1 - m_iSnapshotFront;
+	PoseSnapshot& snapshot = m_Snapshots[back];
+	snapshot.kineticEnergy = 0.0f;
+	for(UINT i=0; i < m_vpBoneActors.size(); ++i)
+	{
+		NxActor* pActor = m_vpBoneActors[i];
+		PhysicsManager::GetInstance()->NMatToDMat(snapshot.poses[i], pActor->getGlobalPose());
+		snapshot.linearVelocities[i] = pActor->getLinearVelocity();
+		snapshot.kineticEnergy += pActor->computeKineticEnergy();
+	}
+	snapshot.anyAwake = anyAwake;
+
+	m_iSnapshotFront = back;
+	if(m_iAmountSnapshots < 2)
+		++m_iAmountSnapshots;
+}
+
+bool PhysxSkeleton::NeedsCapture() const
+{
+	if(m_pOwnerPhysicsAnimator == nullptr || m_vpBoneActors.empty())
+		return false;
+	return m_pOwnerPhysicsAnimator->GetCurrentState() == RagdollState::SeedState || HasActiveRegion();
+}
+
+const D3DXMATRIX& PhysxSkeleton::GetCapturedActorPose(UINT slot) const
+{
+	if(m_iAmountSnapshots > 0)
+		return m_Snapshots[m_iSnapshotFront].poses[slot];
+	return m_matActorWorldPoses[slot];
+}
+
+NxVec3 PhysxSkeleton::GetCapturedLinearVelocity(UINT slot) const
+{
+	if(m_iAmountSnapshots > 0)
+		return m_Snapshots[m_iSnapshotFront].linearVelocities[slot];
+	return NxVec3(0,0,0);
+}
+
+bool PhysxSkeleton::IsAnyActorAwake() const
+{
+	//Pipelined, PhysX is busy with the next step: use what the last capture saw
+	if(RagdollPosePipeline::GetInstance()->IsEnabled())
+		return m_iAmountSnapshots == 0 || m_Snapshots[m_iSnapshotFront].anyAwake;
+
+	for(auto pActor : m_vpBoneActors)
+	{
+		if(!pActor->isSleeping())
+			return true;
+	}
+	return false;
+}
+
+RagdollSettleEvent PhysxSkeleton::UpdateSettleState(float deltaTime)
+{
+	if(m_fTotalMass <= 0.0f)
+		return RagdollSettleEvent::SettleNone;
+
+	//Per unit of mass, so the thresholds don't depend on the size of the ragdoll
+	float energy = m_fKineticEnergy / m_fTotalMass;
+
+	if(m_bSettled)
+	{
+		//Hysteresis: a small nudge doesn't wake us, PhysX puts those actors back to sleep itself
+		if(energy < m_fWakeEnergy || !IsAnyActorAwake())
+			return RagdollSettleEvent::SettleNone;
+
+		m_bSettled = false;
+		m_fRestTime = 0.0f;
+		return RagdollSettleEvent::SettleWoken;
+	}
+
+	if(energy >= m_fSettleEnergy)
 	{
-		//Pass the world transform of model to the bone to do the necessary calculations
-		physxBone->SetModelWorldTransform(m_matWorldTransform);
-		//Get our index
-		int i = physxBone->GetIndex();
-		//Calculate the new transform
-		physxBone->UpdateSeedMode();
-		//Store it by overriding copy of the original transform with the new transform
-		m_BonePhysicsTransforms.at(i) = physxBone->GetActorInModelSpaceTransform();
+		m_fRestTime = 0.0f;
+		return RagdollSettleEvent::SettleNone;
+	}
+
+	m_fRestTime += deltaTime;
+	if(m_fRestTime < m_fSettleTime)
+		return RagdollSettleEvent::SettleNone;
+
+	//Resting long enough, sleeping actors cost no solver time
+	for(auto pActor : m_vpBoneActors)
+		RagdollCommandBuffer::GetInstance()->PutToSleep(pActor, this);
+	m_bSettled = true;
+	m_fKineticEnergy = 0.0f;
+	return RagdollSettleEvent::SettleSettled;
+}
+
+void PhysxSkeleton::ResetSettleState()
+{
+	m_bSettled = false;
+	m_fRestTime = 0.0f;
+	m_fKineticEnergy = 0.0f;
+}
+
+template<UINT Bones>
+void PhysxSkeleton::CalculateLeechPosesFixed()
+{
+	RagdollMath::LeechTransformsFixed<Bones>(m_pDefinition->GetTotalOffsets(), m_BoneTransforms.GetData(),
+		m_pDefinition->GetBoneIndices(), m_matWorldTransform, m_matActorWorldPoses.GetData());
+}
+
+void PhysxSkeleton::CalculateSeedPoses()
+{
+	//Known archetypes use the unrolled loops
+	switch(m_pDefinition->GetLayoutBones())
+	{
+	case HumanoidLayout::AmountOfBones:
+		CalculateSeedPosesFixed<HumanoidLayout::AmountOfBones>();
+		return;
+	case HumanoidReducedLayout::AmountOfBones:
+		CalculateSeedPosesFixed<HumanoidReducedLayout::AmountOfBones>();
+		return;
+	case HumanoidMinimalLayout::AmountOfBones:
+		CalculateSeedPosesFixed<HumanoidMinimalLayout::AmountOfBones>();
+		return;
+	}
+
+	const UINT amountBones = m_matActorModelPoses.GetSize();
+
+	//The world transform is the same for all bones, so only invert it once per skeleton
+	D3DXMATRIX modelWorldSpaceInverse;
+	D3DXMatrixInverse(&modelWorldSpaceInverse, NULL, &m_matWorldTransform);
+
+	//Transform the actors back in model space by using the inverse matrix of our offset
+	RagdollMath::SeedTransforms(m_pDefinition->GetInvTotalOffsets(), m_matActorWorldPoses.GetData(),
+		modelWorldSpaceInverse, m_matActorModelPoses.GetData(), amountBones);
+}
+
+void PhysxSkeleton::WriteSeedPoses()
+{
+	switch(m_pDefinition->GetLayoutBones())
+	{
+	case HumanoidLayout::AmountOfBones:
+		WriteSeedPosesFixed<HumanoidLayout::AmountOfBones>();
+		break;
+	case HumanoidReducedLayout::AmountOfBones:
+		WriteSeedPosesFixed<HumanoidReducedLayout::AmountOfBones>();
+		break;
+	case HumanoidMinimalLayout::AmountOfBones:
+		WriteSeedPosesFixed<HumanoidMinimalLayout::AmountOfBones>();
+		break;
+	default:
+		{
+			//Override the animated transform in the pose buffer with the new transform.
+			//Bones without a PhysxBone keep their animated transform.
+			const UINT amountBones = m_matActorModelPoses.GetSize();
+			const int* pBoneIndices = m_pDefinition->GetBoneIndices();
+			for(UINT i=0; i < amountBones; ++i)
+			{
+				m_BoneTransforms[pBoneIndices[i]] = m_matActorModelPoses[i];
+			}
+		}
+		break;
+	}
+	CopyFollowerPoses();
+}
+
+void PhysxSkeleton::CopyFollowerPoses()
+{
+	//Bones without a body in this LOD tier move rigidly with their driver. Rigid in the
+	//bind pose means the same bone transform, so it's a copy.
+	const UINT amountFollowers = m_pDefinition->GetAmountOfFollowers();
+	const int* pFollowerIndices = m_pDefinition->GetFollowerBoneIndices();
+	const int* pDriverIndices = m_pDefinition->GetFollowerDriverIndices();
+	for(UINT i=0; i < amountFollowers; ++i)
+	{
+		m_BoneTransforms[pFollowerIndices[i]] = m_BoneTransforms[pDriverIndices[i]];
+	}
+}
+
+template<UINT Bones>
+void PhysxSkeleton::CalculateSeedPosesFixed()
+{
+	D3DXMATRIX modelWorldSpaceInverse;
+	D3DXMatrixInverse(&modelWorldSpaceInverse, NULL, &m_matWorldTransform);
+
+	RagdollMath::SeedTransformsFixed<Bones>(m_pDefinition->GetInvTotalOffsets(), m_matActorWorldPoses.GetData(),
+		modelWorldSpaceInverse, m_matActorModelPoses.GetData());
+}
+
+template<UINT Bones>
+void PhysxSkeleton::WriteSeedPosesFixed()
+{
+	const int* pBoneIndices = m_pDefinition->GetBoneIndices();
+	for(UINT i=0; i < Bones; ++i)
+	{
+		m_BoneTransforms[pBoneIndices[i]] = m_matActorModelPoses[i];
 	}
 }
 
@@ -150,24 +564,175 @@ NxActor* PhysxSkeleton::GetRootBoneActor() const
 	return rootBoneActor;
 }
 
-void PhysxSkeleton::CreateSphericalJoint(PhysxBone* bone1, PhysxBone* bone2, const NxVec3& globalAnchor, const NxVec3& globalAxis)
+void PhysxSkeleton::ActivateRegion(UINT rootSlot)
+{
+	if(rootSlot >= m_vpBoneActors.size() || m_RegionMask[rootSlot] != 0)
+		return;
+
+	//The kinematic part has to be where the animation is, the region starts from there as well
+	SyncLeechPoses();
+
+	//The region hangs from the kinematic part by its joints
+	if(!HasJoints())
+		CreateJoints();
+
+	//Mark the subtree. Joints go from parent (bone1) to child (bone2), repeat until
+	//nothing changes so the order of the joints doesn't matter.
+	m_RegionMask[rootSlot] = 1;
+	bool changed = true;
+	while(changed)
+	{
+		changed = false;
+		for(UINT i=0; i < m_pDefinition->GetAmountOfJoints(); ++i)
+		{
+			const RagdollJointDefinition& joint = m_pDefinition->GetJoint(i);
+			if(m_RegionMask[joint.bone1] != 0 && m_RegionMask[joint.bone2] == 0)
+			{
+				m_RegionMask[joint.bone2] = 1;
+				changed = true;
+			}
+		}
+	}
+
+	//Make the new part of the region dynamic
+	for(UINT slot=0; slot < m_vpBoneActors.size(); ++slot)
+	{
+		if(m_RegionMask[slot] == 0 || std::find(m_vRegionSlots.begin(), m_vRegionSlots.end(), slot) != m_vRegionSlots.end())
+			continue;
+
+		m_vRegionSlots.push_back(slot);
+		m_vpPhysxBones[slot]->ClearBodyFlag(NX_BF_KINEMATIC);
+		m_vpPhysxBones[slot]->ClearActorFlag(NX_AF_DISABLE_COLLISION);
+		RagdollCommandBuffer::GetInstance()->WakeUp(m_vpBoneActors[slot], this);
+	}
+
+	//Followers only follow a driver of the region, the others keep their animation
+	m_vRegionFollowers.clear();
+	const int* pDriverIndices = m_pDefinition->GetFollowerDriverIndices();
+	for(UINT i=0; i < m_pDefinition->GetAmountOfFollowers(); ++i)
+	{
+		int driverSlot = m_pDefinition->GetSlotOfMeshBone(pDriverIndices[i]);
+		if(driverSlot >= 0 && m_RegionMask[driverSlot] != 0)
+			m_vRegionFollowers.push_back(i);
+	}
+}
+
+void PhysxSkeleton::DeactivateRegion(bool makeKinematic)
 {
+	if(!HasActiveRegion())
+		return;
+
+	if(makeKinematic)
+	{
+		for(auto slot : m_vRegionSlots)
+		{
+			m_vpPhysxBones[slot]->RaiseBodyFlag(NX_BF_KINEMATIC);
+			m_vpPhysxBones[slot]->RaiseActorFlag(NX_AF_DISABLE_COLLISION);
+		}
+	}
+
+	m_RegionMask.Fill(0);
+	m_vRegionSlots.clear();
+	m_vRegionFollowers.clear();
+
+	//The region moved by itself, the next push has to write all actors
+	m_bPushedPosesValid = false;
+	m_bLeechPosesStale = true;
+}
+
+void PhysxSkeleton::UpdateRegion()
+{
+	if(m_BoneTransforms.empty())
+		return;
+
+	//Leech first: it reads the animation from the pose buffer, before the region overwrites it
+	CalculateLeechPoses();
+	m_bLeechPosesStale = false;
+	PushLeechPoses();
+	m_bLeechSyncRequested = false;
+
+	PullRegionPoses();
+	CalculateRegionSeedPoses();
+}
+
+void PhysxSkeleton::PullRegionPoses()
+{
+	if(RagdollPosePipeline::GetInstance()->IsEnabled())
+	{
+		//Nothing captured yet: the region is still where the activation put it
+		if(m_iAmountSnapshots == 0)
+			return;
+		const float interpolation = RagdollPosePipeline::GetInstance()->GetInterpolation();
+		const PoseSnapshot& snapshot = m_Snapshots[m_iSnapshotFront];
+		for(auto slot : m_vRegionSlots)
+		{
+			if(m_iAmountSnapshots == 2 && interpolation < 1.0f)
+				RagdollMath::InterpolatePoses(&m_Snapshots[1 - m_iSnapshotFront].poses[slot], &snapshot.poses[slot],
+					interpolation, &m_matActorWorldPoses[slot], 1);
+			else
+				m_matActorWorldPoses[slot] = snapshot.poses[slot];
+		}
+		return;
+	}
+
+	for(auto slot : m_vRegionSlots)
+		PhysicsManager::GetInstance()->NMatToDMat(m_matActorWorldPoses[slot], m_vpBoneActors[slot]->getGlobalPose());
+}
+
+void PhysxSkeleton::CalculateRegionSeedPoses()
+{
+	D3DXMATRIX modelWorldSpaceInverse;
+	D3DXMatrixInverse(&modelWorldSpaceInverse, NULL, &m_matWorldTransform);
+
+	//Only the region, the other bones keep their animated transform
+	const D3DXMATRIX* pInvTotalOffsets = m_pDefinition->GetInvTotalOffsets();
+	const int* pBoneIndices = m_pDefinition->GetBoneIndices();
+	for(auto slot : m_vRegionSlots)
+	{
+		RagdollMath::SeedTransforms(pInvTotalOffsets + slot, &m_matActorWorldPoses[slot],
+			modelWorldSpaceInverse, &m_matActorModelPoses[slot], 1);
+		m_BoneTransforms[pBoneIndices[slot]] = m_matActorModelPoses[slot];
+	}
+
+	const int* pFollowerIndices = m_pDefinition->GetFollowerBoneIndices();
+	const int* pDriverIndices = m_pDefinition->GetFollowerDriverIndices();
+	for(auto follower : m_vRegionFollowers)
+		m_BoneTransforms[pFollowerIndices[follower]] = m_BoneTransforms[pDriverIndices[follower]];
+}
+
+void PhysxSkeleton::SetSolverIterations(UINT iterations)
+{
+	if(iterations == 0)
+		iterations = RagdollLodPolicy::GetSettings(m_pDefinition->GetLod()).solverIterations;
+
+	RagdollCommandBuffer* pCommands = RagdollCommandBuffer::GetInstance();
+	for(auto pActor : m_vpBoneActors)
+		pCommands->SetSolverIterationCount(pActor, iterations, this);
+}
+
+void PhysxSkeleton::CreateSphericalJoint(const RagdollJointDefinition& joint)
+{
+	//The joint frames are precalculated in the definition, so the current pose of the actors doesn't matter
 	NxSphericalJointDesc sphericalDesc;
-	sphericalDesc.actor[0] = bone1->GetActor();
-	sphericalDesc.actor[1] = bone2->GetActor();
-	sphericalDesc.setGlobalAnchor(globalAnchor);
-	sphericalDesc.setGlobalAxis(globalAxis);
+	for(int i=0; i < 2; ++i)
+	{
+		sphericalDesc.localAnchor[i] = joint.localAnchor[i];
+		sphericalDesc.localAxis[i] = joint.localAxis[i];
+		sphericalDesc.localNormal[i] = joint.localNormal[i];
+	}
+	sphericalDesc.actor[0] = m_vpBoneActors[joint.bone1];
+	sphericalDesc.actor[1] = m_vpBoneActors[joint.bone2];
 
 	sphericalDesc.flags |= NX_SJF_TWIST_LIMIT_ENABLED;
-	sphericalDesc.twistLimit.low.value = -(NxReal)0.025f*NxPi;
+	sphericalDesc.twistLimit.low.value = (NxReal)joint.twistLow;
 	sphericalDesc.twistLimit.low.hardness = 0.5f;
 	sphericalDesc.twistLimit.low.restitution = 0.5f;
-	sphericalDesc.twistLimit.high.value = (NxReal)0.025f*NxPi;
+	sphericalDesc.twistLimit.high.value = (NxReal)joint.twistHigh;
 	sphericalDesc.twistLimit.high.hardness = 0.5f;
 	sphericalDesc.twistLimit.high.restitution = 0.5f;
 
 	sphericalDesc.flags |= NX_SJF_SWING_LIMIT_ENABLED;
-	sphericalDesc.swingLimit.value = (NxReal)0.25f*NxPi;
+	sphericalDesc.swingLimit.value = (NxReal)joint.swingLimit;
 	sphericalDesc.swingLimit.hardness = 0.5f;
 	sphericalDesc.swingLimit.restitution = 0.5f;
 
@@ -184,17 +749,36 @@ void PhysxSkeleton::CreateSphericalJoint(PhysxBone* bone1, PhysxBone* bone2, con
 	sphericalDesc.projectionDistance = (NxReal)0.15f;
 	sphericalDesc.projectionMode = NX_JPM_POINT_MINDIST;
 
-	NxSphericalJoint* sphericalJoint = dynamic_cast<NxSphericalJoint*>(m_pPhysicsScene->createJoint(sphericalDesc));
-	m_vpSphericalJoints.push_back(sphericalJoint);
+	//Created at the flush, the slot stays empty until then
+	UINT index = m_vpSphericalJoints.size();
+	UINT generation = m_iJointGeneration;
+	m_vpSphericalJoints.push_back(nullptr);
+	RagdollCommandBuffer::GetInstance()->CreateJoint(m_pPhysicsScene, sphericalDesc,
+		[this, index, generation](NxJoint* pJoint)
+		{
+			if(pJoint == nullptr)
+				return;
+			//Released again before it existed
+			if(generation != m_iJointGeneration)
+			{
+				RagdollReleaseQueue::GetInstance()->QueueRelease(m_pPhysicsScene, pJoint);
+				return;
+			}
+			m_vpSphericalJoints[index] = pJoint->isSphericalJoint();
+		}, this);
 }
 
-void PhysxSkeleton::CreateRevoluteJoint(PhysxBone* bone1, PhysxBone* bone2, const NxVec3& globalAnchor, const NxVec3& globalAxis)
+void PhysxSkeleton::CreateRevoluteJoint(const RagdollJointDefinition& joint)
 {
 	NxRevoluteJointDesc revoluteDesc;
-	revoluteDesc.actor[0] = bone1->GetActor();
-	revoluteDesc.actor[1] = bone2->GetActor();
-	revoluteDesc.setGlobalAnchor(globalAnchor);
-	revoluteDesc.setGlobalAxis(globalAxis);
+	for(int i=0; i < 2; ++i)
+	{
+		revoluteDesc.localAnchor[i] = joint.localAnchor[i];
+		revoluteDesc.localAxis[i] = joint.localAxis[i];
+		revoluteDesc.localNormal[i] = joint.localNormal[i];
+	}
+	revoluteDesc.actor[0] = m_vpBoneActors[joint.bone1];
+	revoluteDesc.actor[1] = m_vpBoneActors[joint.bone2];
 
 	/*NxJointLimitDesc limitLowDesc;
 	limitLowDesc.value = 0.0f  * (NxPi/180.0f);
@@ -204,56 +788,98 @@ void PhysxSkeleton::CreateRevoluteJoint(PhysxBone* bone1, PhysxBone* bone2, cons
 	limitHighDesc.value = 90.0f * (NxPi/180.0f);
 	revoluteDesc.limit.high = limitHighDesc;*/
 
-	NxRevoluteJoint* revoluteJoint = dynamic_cast<NxRevoluteJoint*>(m_pPhysicsScene->createJoint(revoluteDesc));
-	m_vpRevoluteJoints.push_back(revoluteJoint);
+	UINT index = m_vpRevoluteJoints.size();
+	UINT generation = m_iJointGeneration;
+	m_vpRevoluteJoints.push_back(nullptr);
+	RagdollCommandBuffer::GetInstance()->CreateJoint(m_pPhysicsScene, revoluteDesc,
+		[this, index, generation](NxJoint* pJoint)
+		{
+			if(pJoint == nullptr)
+				return;
+			if(generation != m_iJointGeneration)
+			{
+				RagdollReleaseQueue::GetInstance()->QueueRelease(m_pPhysicsScene, pJoint);
+				return;
+			}
+			m_vpRevoluteJoints[index] = pJoint->isRevoluteJoint();
+		}, this);
 }
 
 void PhysxSkeleton::CreateJoints()
 {
-	//For all JointLayouts, create the proper joints
-	for(auto jointLayout : m_vJointLayouts)
+	//For all joints in the definition, create the proper joints
+	for(UINT i=0; i < m_pDefinition->GetAmountOfJoints(); ++i)
 	{
-		if(jointLayout.jointType == JointType::spherical)
-		{
-			//Find the globalAnchor
-			NxVec3 globalAnchor;
-			if(jointLayout.anchorBone == JointBone::PhysxBone1)
-				globalAnchor = jointLayout.pBone1->GetActor()->getGlobalPosition();
-			else if(jointLayout.anchorBone == JointBone::PhysxBone2)
-				globalAnchor = jointLayout.pBone2->GetActor()->getGlobalPosition();
-
-			//CreateJoint
-			CreateSphericalJoint(jointLayout.pBone1, jointLayout.pBone2, globalAnchor, jointLayout.axisOrientation);
-		}
-		else if(jointLayout.jointType == JointType::revolute)
-		{
-			//Find the globalAnchor
-			NxVec3 globalAnchor;
-			if(jointLayout.anchorBone == JointBone::PhysxBone1)
-				globalAnchor = jointLayout.pBone1->GetActor()->getGlobalPosition();
-			else if(jointLayout.anchorBone == JointBone::PhysxBone2)
-				globalAnchor = jointLayout.pBone2->GetActor()->getGlobalPosition();
-
-			//CreateJoint
-			CreateRevoluteJoint(jointLayout.pBone1, jointLayout.pBone2, globalAnchor, jointLayout.axisOrientation);
-		}
+		const RagdollJointDefinition& joint = m_pDefinition->GetJoint(i);
+		if(joint.jointType == JointType::spherical)
+			CreateSphericalJoint(joint);
+		else if(joint.jointType == JointType::revolute)
+			CreateRevoluteJoint(joint);
+	}
+}
+
+void PhysxSkeleton::Attach(PhysicsAnimator* ownerPhysicsAnimator)
+{
+	m_pOwnerPhysicsAnimator = ownerPhysicsAnimator;
+	m_BoneTransforms = (m_pOwnerPhysicsAnimator != nullptr) ?
+		m_pOwnerPhysicsAnimator->GetBoneTransformBuffer() : ArrayView<D3DXMATRIX>();
+	//The actors haven't seen the pose of the new owner yet
+	m_bLeechPosesStale = true;
+	InvalidateSnapshots();
+}
+
+void PhysxSkeleton::Park(const D3DXMATRIX& parkTransform)
+{
+	//Drop the owner, its pose buffer dies with it
+	Attach(nullptr);
+	//The loop below makes all actors kinematic
+	DeactivateRegion(false);
+	m_matWorldTransform = parkTransform;
+
+	//The next owner starts walking, it gets joints when it is knocked down
+	ReleaseJoints();
+
+	//Same state as LeechState, in the bind pose so the joints are relaxed when the next owner gets it
+	const D3DXMATRIX* pTotalOffsets = m_pDefinition->GetTotalOffsets();
+	RagdollCommandBuffer* pCommands = RagdollCommandBuffer::GetInstance();
+	NxMat34 nPos;
+	for(UINT slot=0; slot < m_vpBoneActors.size(); ++slot)
+	{
+		//No readBodyFlag: while recording, the flag PhysX has now is not the one it will have at the flush
+		NxActor* pActor = m_vpBoneActors[slot];
+		pCommands->SetLinearVelocity(pActor, NxVec3(0,0,0), this);
+		pCommands->SetAngularVelocity(pActor, NxVec3(0,0,0), this);
+		pCommands->RaiseBodyFlag(pActor, NX_BF_KINEMATIC, this);
+		pCommands->RaiseActorFlag(pActor, NX_AF_DISABLE_COLLISION, this);
+
+		m_matActorWorldPoses[slot] = pTotalOffsets[slot] * m_matWorldTransform;
+		PhysicsManager::GetInstance()->DMatToNMat(nPos, m_matActorWorldPoses[slot]);
+		pCommands->SetGlobalPose(pActor, nPos, this);
+		m_matActorPushedPoses[slot] = m_matActorWorldPoses[slot];
 	}
+	m_bPushedPosesValid = true;
+	m_bLeechPosesStale = true;
+	m_bLeechSyncRequested = false;
+	ResetSettleState();
 }
 
 void PhysxSkeleton::ReleaseJoints()
 {
+	//The joints are released by the release queue, so deleting many ragdolls in one frame doesn't stall
 	for(auto sphericalJoint : m_vpSphericalJoints)
 	{
 		if(sphericalJoint != nullptr)
-			m_pPhysicsScene->releaseJoint(*sphericalJoint);
+			RagdollReleaseQueue::GetInstance()->QueueRelease(m_pPhysicsScene, sphericalJoint);
 	}
 	for(auto revoluteJoint : m_vpRevoluteJoints)
 	{
 		if(revoluteJoint != nullptr)
-			m_pPhysicsScene->releaseJoint(*revoluteJoint);
+			RagdollReleaseQueue::GetInstance()->QueueRelease(m_pPhysicsScene, revoluteJoint);
 	}
 
 	//clear vectors
 	m_vpSphericalJoints.clear();
 	m_vpRevoluteJoints.clear();
+	//Joints still waiting for the flush are released as soon as they are created
+	++m_iJointGeneration;
 }
\ No newline at end of file
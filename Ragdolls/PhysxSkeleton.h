@@ -10,6 +10,9 @@
 #include "../../../OverlordEngine/OverlordComponents.h"
 #include "../Ragdolls/RagdollHelper.h"
 #include "../Ragdolls/PhysxBone.h"
+#include "../Ragdolls/AlignedBuffer.h"
+#include "../Ragdolls/ArrayView.h"
+#include "../Ragdolls/RagdollDefinition.h"
 #include <vector>
 #include <memory>
 
@@ -17,63 +20,199 @@ class PhysxSkeleton final
 {
 public:
 	//Constructor and Destructor
-	PhysxSkeleton(NxScene* pScene, PhysicsGroup group, PhysicsAnimator* ownerPhysicsAnimator);
+	PhysxSkeleton(NxScene* pScene, PhysicsGroup group, PhysicsAnimator* ownerPhysicsAnimator,
+		const std::shared_ptr<const RagdollDefinition>& pDefinition);
 	~PhysxSkeleton(void);
 
 	//Methods
-	//Adds a bone to the skeleton
-	void AddBone(const PhysxBoneLayout& boneLayout);
-	//Adds a joint layout to the skeleton so we can create our joints when needed
-	void AddJoint(const PhysxJointLayout& jointLayout);
-	//Creates and maps the bones of the skeleton
-	void Initiliaze(MeshFilter* pMeshFilter);
-	//Updates the skeleton (all the bones)
+	//Creates the bones of the skeleton, based on the (already mapped) definition
+	void Initiliaze();
+	//Updates the skeleton (all the bones).
+	//In LeechState the kinematic actors are only moved when something can see them,
+	//see RequestLeechSync and SyncLeechPoses.
 	void UpdateLeechMode(GameContext& context);
 	void UpdateSeedMode(GameContext& context);
-	//Creates all joints
+	//Updates a whole batch of skeletons. The math for all skeletons runs in parallel chunks on
+	//the RagdollJobSystem, the PhysX reads and writes stay on the calling thread.
+	static void UpdateLeechMode(PhysxSkeleton* const* ppSkeletons, UINT amountSkeletons);
+	static void UpdateSeedMode(PhysxSkeleton* const* ppSkeletons, UINT amountSkeletons);
+	//Moves the kinematic actors in the next UpdateLeechMode. Requests only last one frame.
+	void RequestLeechSync() {m_bLeechSyncRequested = true;};
+	//Moves the kinematic actors to the current animation right now (before a raycast,
+	//a save or going to SeedState). Actors that didn't move are skipped.
+	void SyncLeechPoses();
+	//Settle detection, SeedState only. Uses the kinetic energy gathered by the last UpdateSeedMode.
+	//Once settled the actors are put to sleep and UpdateSeedMode skips the skeleton until PhysX wakes one.
+	RagdollSettleEvent UpdateSettleState(float deltaTime);
+	//Forget the settle state (state changes, pooling)
+	void ResetSettleState();
+	bool IsSettled() const {return m_bSettled;};
+	//Kinetic energy per unit of mass (linear + angular) below which the ragdoll counts as resting,
+	//the energy above which a settled ragdoll counts as woken, and how long it has to rest
+	void SetSettleThresholds(float settleEnergy, float wakeEnergy, float settleTime)
+	{
+		m_fSettleEnergy = settleEnergy;
+		m_fWakeEnergy = wakeEnergy;
+		m_fSettleTime = settleTime;
+	};
+	//Regional activation (LeechState): the subtree starting at this slot goes dynamic, the rest
+	//keeps following the animation kinematically. Only the region is written back to the pose buffer.
+	//Activating a second region adds it to the first.
+	void ActivateRegion(UINT rootSlot);
+	//Back to fully kinematic. Without makeKinematic the flags are left to the caller
+	//(going to SeedState or parking), the region keeps its simulated pose.
+	void DeactivateRegion(bool makeKinematic = true);
+	bool HasActiveRegion() const {return !m_vRegionSlots.empty();};
+	bool IsInRegion(UINT slot) const {return m_RegionMask[slot] != 0;};
+	//Pipelining (see RagdollPosePipeline): reads the actors into the back snapshot and makes it the front one.
+	//Game thread only, after fetchResults and before the next simulate.
+	void CapturePoses();
+	//Only simulating skeletons (SeedState or an active region) need a capture
+	bool NeedsCapture() const;
+	//Latest known world pose and velocity of an actor without touching PhysX: the captured one, or where
+	//we last put it if nothing was captured since we moved the actors ourselves
+	const D3DXMATRIX& GetCapturedActorPose(UINT slot) const;
+	NxVec3 GetCapturedLinearVelocity(UINT slot) const;
+	//Solver iterations of all actors, 0 for the default of our LOD tier
+	void SetSolverIterations(UINT iterations);
+	//Creates all joints, from the joint frames precalculated in the definition
 	void CreateJoints();
-	//Releases all joints
+	//Releases all joints (through the release queue)
 	void ReleaseJoints();
+	//Joints only exist while the ragdoll needs them (see PhysicsAnimator).
+	//While the RagdollCommandBuffer records, they are created at its flush.
+	bool HasJoints() const {return !m_vpSphericalJoints.empty() || !m_vpRevoluteJoints.empty();};
+
+	//Pooling (see RagdollPool). A parked skeleton keeps its actors, but is kinematic,
+	//collision-disabled and moved out of the way, without an owner and without joints.
+	void Attach(PhysicsAnimator* ownerPhysicsAnimator);
+	void Park(const D3DXMATRIX& parkTransform);
+	bool IsParked() const {return m_pOwnerPhysicsAnimator == nullptr;};
 
 	//Getters
-	//Seeds bone transforms based on PhysX actors
-	vector<D3DXMATRIX> SeedBoneTransforms() const {return m_BonePhysicsTransforms;};
-	//Returns all the PhysxBones
-	vector<PhysxBone*> GetPhysxBones() const {return m_vpPhysxBones;};
-	//Searches for the PhysxBone mapped based on the received layout
-	PhysxBone* GetPhysxBone(const PhysxBoneLayout& boneLayout) const;
+	//Seeds bone transforms based on PhysX actors (view on the pose buffer of the owner)
+	ArrayView<const D3DXMATRIX> SeedBoneTransforms() const {return m_BoneTransforms;};
+	//Returns all the PhysxBones. The view stays valid for the lifetime of the skeleton.
+	ArrayView<PhysxBone* const> GetPhysxBones() const {return m_vpPhysxBones;};
+	//Searches for the PhysxBone with the given (interned) name. Prefer the id version in
+	//code that runs every frame, the string version needs a lookup in the BoneNameTable.
+	PhysxBone* GetPhysxBone(BoneNameId nameId) const;
+	PhysxBone* GetPhysxBone(const tstring& name) const;
+	//Returns the PhysxBone driving the mesh bone with this index, nullptr if there is none
+	PhysxBone* GetPhysxBoneOfMeshBone(int meshBoneIndex) const;
+	//Return the definition this skeleton was built from
+	const RagdollDefinition* GetDefinition() const {return m_pDefinition.get();};
+	//Return the scene and group the actors live in
+	NxScene* GetPhysicsScene() const {return m_pPhysicsScene;};
+	PhysicsGroup GetPhysicsGroup() const {return m_nxPhysxGroup;};
 	//Return the PhysxAnimator owning this skeleton
 	PhysicsAnimator* GetOwnerPhysxAnimator() const {return m_pOwnerPhysicsAnimator;};
-	//Returns all actors of this skeleton
-	vector<NxActor*> GetBoneActors() const;
+	//Returns all actors of this skeleton. Built once in Initiliaze, no allocations.
+	ArrayView<NxActor* const> GetBoneActors() const {return m_vpBoneActors;};
 	//Returns the root bone's actor. == First bone in hierarchy
 	NxActor* GetRootBoneActor() const;
+	//Returns the amount of PhysxBones
+	UINT GetAmountOfBones() const {return m_vpPhysxBones.size();};
+	//Hot data of a single bone, slot == order of the bones in the definition
+	int GetBoneIndex(UINT slot) const {return m_pDefinition->GetBoneIndices()[slot];};
+	const D3DXMATRIX& GetActorOffset(UINT slot) const {return m_pDefinition->GetTotalOffsets()[slot];};
+	const D3DXMATRIX& GetActorWorldSpaceTransform(UINT slot) const {return m_matActorWorldPoses[slot];};
+	const D3DXMATRIX& GetActorModelSpaceTransform(UINT slot) const {return m_matActorModelPoses[slot];};
 
 	//Setters
-	//sets the bone transforms
-	void FeedBoneTransforms(vector<D3DXMATRIX> boneTransforms){m_BoneOriginalTransforms = boneTransforms;};
+	//Sets the pose buffer we read the animation from (LeechMode) and write our result in (SeedMode)
+	void SetBoneTransformBuffer(ArrayView<D3DXMATRIX> boneTransforms){m_BoneTransforms = boneTransforms;};
 	//Sets the worldTransform of the object we resemble. Needed for all bones of this skeleton.
 	void SetWorldTransform(const D3DXMATRIX& worldTransform){m_matWorldTransform = worldTransform;};
 
 private:
 	//Datamembers
+	//Cold data: layouts, names and PhysX handles. Not touched by the math in the update loops.
 	vector<PhysxBone*> m_vpPhysxBones;
-	vector<PhysxJointLayout> m_vJointLayouts;
+	vector<NxActor*> m_vpBoneActors;
 	vector<NxSphericalJoint*> m_vpSphericalJoints;
 	vector<NxRevoluteJoint*> m_vpRevoluteJoints;
+	UINT m_iJointGeneration; //Bumped by ReleaseJoints, joints created after that are stale
 
-	vector<D3DXMATRIX> m_BoneOriginalTransforms;
-	vector<D3DXMATRIX> m_BonePhysicsTransforms;
+	ArrayView<D3DXMATRIX> m_BoneTransforms; //Pose buffer owned by the PhysicsAnimator
 	D3DXMATRIX m_matWorldTransform;
 
+	//Shared read-only setup: layouts, joints, bone indices and (inverse) offsets
+	std::shared_ptr<const RagdollDefinition> m_pDefinition;
+
+	//Hot data: one entry per PhysxBone (Structure of Arrays) so the update loops stream linearly.
+	//Also sized at runtime for the layouts: the same skeleton class serves every definition, and the
+	//pool builds a skeleton only once. Only the loops over them are fixed size (see CalculateSeedPosesFixed).
+	AlignedBuffer<D3DXMATRIX> m_matActorWorldPoses; //WorldSpace position of the actors
+	AlignedBuffer<D3DXMATRIX> m_matActorModelPoses; //Actor positions in model space (seed result)
+	AlignedBuffer<D3DXMATRIX> m_matActorPushedPoses; //Last poses written to PhysX in LeechMode
+
+	//Regional activation: a flag per slot, and the slots and followers (index in the follower
+	//table of the definition) of the region so the writeback only loops over those
+	AlignedBuffer<BYTE> m_RegionMask;
+	vector<UINT> m_vRegionSlots;
+	vector<UINT> m_vRegionFollowers;
+
+	//Leech sync on demand
+	bool m_bLeechPosesStale; //The animation changed since the last CalculateLeechPoses
+	bool m_bLeechSyncRequested; //Someone wants the actors in sync this frame
+	bool m_bPushedPosesValid; //False when the actors moved by themselves (SeedMode)
+	bool m_bSeedPulled; //Batch: the seed poses were read this frame, so the math has to run
+
+	//Pipelining: the state of the actors at the last two fetchResults (or fixed steps), m_iSnapshotFront is the latest.
+	//Only the snapshots captured after our last teleport of the actors are valid.
+	struct PoseSnapshot
+	{
+		AlignedBuffer<D3DXMATRIX> poses;
+		AlignedBuffer<NxVec3> linearVelocities;
+		float kineticEnergy;
+		bool anyAwake;
+	};
+	PoseSnapshot m_Snapshots[2];
+	UINT m_iSnapshotFront;
+	UINT m_iAmountSnapshots;
+
+	//Settle detection
+	float m_fTotalMass; //Mass of all actors, doesn't change
+	float m_fKineticEnergy; //Summed over all actors in PullSeedPoses
+	float m_fSettleEnergy, m_fWakeEnergy, m_fSettleTime; //Thresholds (per unit of mass) and time
+	float m_fRestTime; //How long the energy is below the settle threshold
+	bool m_bSettled;
+
 	NxScene* m_pPhysicsScene;
 	PhysicsGroup m_nxPhysxGroup;
 
 	PhysicsAnimator* m_pOwnerPhysicsAnimator;
 
 	//Methods
-	void CreateSphericalJoint(PhysxBone* bone1, PhysxBone* bone2, const NxVec3& globalAnchor, const NxVec3& globalAxis);
-	void CreateRevoluteJoint(PhysxBone* bone1, PhysxBone* bone2, const NxVec3& globalAnchor, const NxVec3& globalAxis);
+	//The update phases: math on the hot arrays and the PhysX reads/writes
+	void CalculateLeechPoses();
+	void PushLeechPoses();
+	void PullSeedPoses();
+	//Pipelined version of PullSeedPoses, only copies the front snapshot (no PhysX, safe in a job).
+	//With a fixed step it blends between the last two snapshots.
+	void CopySnapshotPoses(float interpolation);
+	//We moved the actors ourselves, the snapshots don't show that until the next capture
+	void InvalidateSnapshots() {m_iAmountSnapshots = 0;};
+	//LeechState with an active region: the kinematic part follows the animation every frame
+	//(it carries the region), the region is read back like in SeedState
+	void UpdateRegion();
+	void PullRegionPoses();
+	void CalculateRegionSeedPoses();
+	//True if PhysX woke one of our (sleeping) actors
+	bool IsAnyActorAwake() const;
+	void CalculateSeedPoses();
+	//Writes the actor poses in model space (and the followers) in the pose buffer. The animation
+	//writes in it every frame, so also when a settled ragdoll skips the PhysX reads and the math.
+	void WriteSeedPoses();
+	//Fixed size versions for the compile time layouts, the loops get unrolled
+	template<UINT Bones> void CalculateLeechPosesFixed();
+	template<UINT Bones> void CalculateSeedPosesFixed();
+	template<UINT Bones> void WriteSeedPosesFixed();
+	//Followers (mesh bones without a body in this LOD tier) take the transform of their driver
+	void CopyFollowerPoses();
+	void CreateSphericalJoint(const RagdollJointDefinition& joint);
+	void CreateRevoluteJoint(const RagdollJointDefinition& joint);
 
 	//Operators
 	// -------------------------
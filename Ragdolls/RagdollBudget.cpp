@@ -0,0 +1,112 @@
+//--------------------------------------------------------------------------------------
+// RagdollBudget: caps the amount of ragdolls simulated at once. The ragdolls in SeedState
+// are ranked by interaction, distance and recency every frame, the ones over budget are
+// baked, downgraded or frozen.
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "RagdollBudget.h"
+#include "PhysicsAnimator.h"
+#include <algorithm>
+
+RagdollBudget* RagdollBudget::m_pInstance = nullptr;
+
+RagdollBudget::RagdollBudget(void):
+	m_iMaxSimulated(12),
+	m_iMaxDowngraded(8),
+	m_fRecencyWeight(10.0f),
+	m_iAmountSimulated(0),
+	m_iAmountDowngraded(0),
+	m_iAmountFrozen(0),
+	m_iAmountBaked(0)
+{
+}
+
+RagdollBudget::~RagdollBudget(void)
+{
+}
+
+RagdollBudget* RagdollBudget::GetInstance()
+{
+	if(m_pInstance == nullptr)
+		m_pInstance = new RagdollBudget();
+	return m_pInstance;
+}
+
+void RagdollBudget::DestroyInstance()
+{
+	SafeDelete(m_pInstance);
+}
+
+void RagdollBudget::Register(PhysicsAnimator* pAnimator)
+{
+	if(pAnimator != nullptr)
+		m_vpAnimators.push_back(pAnimator);
+}
+
+void RagdollBudget::Unregister(PhysicsAnimator* pAnimator)
+{
+	auto it = std::find(m_vpAnimators.begin(), m_vpAnimators.end(), pAnimator);
+	if(it == m_vpAnimators.end())
+		return;
+
+	//Order doesn't matter, we sort every Update
+	*it = m_vpAnimators.back();
+	m_vpAnimators.pop_back();
+}
+
+void RagdollBudget::Update()
+{
+	m_iAmountSimulated = m_iAmountDowngraded = m_iAmountFrozen = m_iAmountBaked = 0;
+
+	//Only ragdolls that are (or could be) simulating compete for the budget
+	m_vCandidates.clear();
+	for(auto pAnimator : m_vpAnimators)
+	{
+		if(pAnimator->GetCurrentState() != RagdollState::SeedState || pAnimator->IsBaked())
+			continue;
+
+		Candidate candidate = {pAnimator, 0.0f};
+		if(pAnimator->IsBudgetImportant())
+			candidate.score = -FLT_MAX;
+		else
+			candidate.score = pAnimator->GetBudgetDistance() + m_fRecencyWeight * pAnimator->GetSimulatedTime();
+		m_vCandidates.push_back(candidate);
+	}
+
+	//Nothing to cut
+	if(m_iMaxSimulated == 0 || m_vCandidates.size() <= m_iMaxSimulated)
+	{
+		for(auto& candidate : m_vCandidates)
+			candidate.pAnimator->SetBudgetLevel(RagdollBudgetLevel::BudgetSimulated);
+		m_iAmountSimulated = m_vCandidates.size();
+		return;
+	}
+
+	std::sort(m_vCandidates.begin(), m_vCandidates.end(),
+		[](const Candidate& a, const Candidate& b) { return a.score < b.score; });
+
+	for(UINT rank=0; rank < m_vCandidates.size(); ++rank)
+	{
+		PhysicsAnimator* pAnimator = m_vCandidates[rank].pAnimator;
+		if(rank < m_iMaxSimulated)
+		{
+			pAnimator->SetBudgetLevel(RagdollBudgetLevel::BudgetSimulated);
+			++m_iAmountSimulated;
+		}
+		//A ragdoll at rest doesn't need its actors, give them back to the pool
+		else if(pAnimator->IsSettled() && pAnimator->Bake())
+		{
+			++m_iAmountBaked;
+		}
+		else if(rank < m_iMaxSimulated + m_iMaxDowngraded)
+		{
+			pAnimator->SetBudgetLevel(RagdollBudgetLevel::BudgetDowngraded);
+			++m_iAmountDowngraded;
+		}
+		else
+		{
+			pAnimator->SetBudgetLevel(RagdollBudgetLevel::BudgetFrozen);
+			++m_iAmountFrozen;
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef RAGDOLLBUDGET_H_INCLUDED_
+#define RAGDOLLBUDGET_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// RagdollBudget: caps the amount of ragdolls simulated at once. The ragdolls in SeedState
+// are ranked by interaction, distance and recency every frame, the ones over budget are
+// baked, downgraded or frozen.
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include <vector>
+
+class PhysicsAnimator;
+
+class RagdollBudget final
+{
+public:
+	static RagdollBudget* GetInstance();
+	static void DestroyInstance();
+
+	//METHODS
+	//Every PhysicsAnimator registers itself for its lifetime
+	void Register(PhysicsAnimator* pAnimator);
+	void Unregister(PhysicsAnimator* pAnimator);
+	//Ranks the ragdolls and hands out the budget. Call once per frame, before the
+	//ragdolls are updated and outside the simulate window.
+	void Update();
+
+	//SETTERS
+	//Maximum amount of fully simulated ragdolls. 0 == no limit.
+	void SetMaxSimulated(UINT amount) {m_iMaxSimulated = amount;};
+	//Amount of ragdolls over the budget that are still simulated, with the minimum solver
+	//iterations. Everything past that is frozen.
+	void SetMaxDowngraded(UINT amount) {m_iMaxDowngraded = amount;};
+	//Score = distance + recencyWeight * seconds simulated, the lowest score wins.
+	//Ragdolls the player interacts with always come first.
+	void SetRecencyWeight(float weight) {m_fRecencyWeight = weight;};
+
+	//GETTERS
+	//Result of the last Update
+	UINT GetAmountSimulated() const {return m_iAmountSimulated;};
+	UINT GetAmountDowngraded() const {return m_iAmountDowngraded;};
+	UINT GetAmountFrozen() const {return m_iAmountFrozen;};
+	UINT GetAmountBaked() const {return m_iAmountBaked;};
+
+private:
+	RagdollBudget(void);
+	~RagdollBudget(void);
+
+	static RagdollBudget* m_pInstance;
+
+	struct Candidate
+	{
+		PhysicsAnimator* pAnimator;
+		float score;
+	};
+
+	std::vector<PhysicsAnimator*> m_vpAnimators;
+	std::vector<Candidate> m_vCandidates; //Reused every Update, no allocations once grown
+
+	UINT m_iMaxSimulated;
+	UINT m_iMaxDowngraded;
+	float m_fRecencyWeight;
+
+	UINT m_iAmountSimulated;
+	UINT m_iAmountDowngraded;
+	UINT m_iAmountFrozen;
+	UINT m_iAmountBaked;
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	RagdollBudget(const RagdollBudget& yRef);
+	RagdollBudget& operator=(const RagdollBudget& yRef);
+};
+#endif
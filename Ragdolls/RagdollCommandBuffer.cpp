@@ -0,0 +1,327 @@
+//--------------------------------------------------------------------------------------
+// RagdollCommandBuffer: records the PhysX scene writes of the ragdolls (poses, velocities,
+// flags, sleeping, joints, solver and contact report settings) in a buffer per thread and
+// applies them all at one flush point, in a deterministic order, outside the simulate window
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "RagdollCommandBuffer.h"
+#include "RagdollJobSystem.h"
+#include <algorithm>
+
+RagdollCommandBuffer* RagdollCommandBuffer::m_pInstance = nullptr;
+
+RagdollCommandBuffer::RagdollCommandBuffer(void):
+	m_bRecording(false),
+	m_bFlushing(false),
+	m_iFlushedLastFrame(0)
+{
+	ResizeBuffers();
+}
+
+RagdollCommandBuffer::~RagdollCommandBuffer(void)
+{
+	//The scene flushes every frame, whatever is left here points at actors that may be gone
+	m_vBuffers.clear();
+}
+
+RagdollCommandBuffer* RagdollCommandBuffer::GetInstance()
+{
+	if(m_pInstance == nullptr)
+		m_pInstance = new RagdollCommandBuffer();
+	return m_pInstance;
+}
+
+void RagdollCommandBuffer::DestroyInstance()
+{
+	SafeDelete(m_pInstance);
+}
+
+void RagdollCommandBuffer::SetRecording(bool recording)
+{
+	//Whatever was recorded goes out before we switch
+	Flush();
+	m_bRecording = recording;
+}
+
+void RagdollCommandBuffer::ResizeBuffers()
+{
+	//Doesn't create the job system, recording must not start its threads (or bring it back at shutdown)
+	UINT amountThreads = RagdollJobSystem::GetAmountRunningWorkers() + 1;
+	if(m_vBuffers.size() != amountThreads)
+		m_vBuffers.resize(amountThreads);
+}
+
+void RagdollCommandBuffer::SetGlobalPose(NxActor* pActor, const NxMat34& pose, const void* pOwner)
+{
+	Command command;
+	command.type = RagdollCommandType::CommandSetGlobalPose;
+	command.pOwner = pOwner;
+	command.pActor = pActor;
+	command.pose = pose;
+	Record(command);
+}
+
+void RagdollCommandBuffer::SetLinearVelocity(NxActor* pActor, const NxVec3& velocity, const void* pOwner)
+{
+	Command command;
+	command.type = RagdollCommandType::CommandSetLinearVelocity;
+	command.pOwner = pOwner;
+	command.pActor = pActor;
+	command.vector = velocity;
+	Record(command);
+}
+
+void RagdollCommandBuffer::SetAngularVelocity(NxActor* pActor, const NxVec3& velocity, const void* pOwner)
+{
+	Command command;
+	command.type = RagdollCommandType::CommandSetAngularVelocity;
+	command.pOwner = pOwner;
+	command.pActor = pActor;
+	command.vector = velocity;
+	Record(command);
+}
+
+void RagdollCommandBuffer::RaiseBodyFlag(NxActor* pActor, NxBodyFlag flag, const void* pOwner)
+{
+	Command command;
+	command.type = RagdollCommandType::CommandRaiseBodyFlag;
+	command.pOwner = pOwner;
+	command.pActor = pActor;
+	command.flag = flag;
+	Record(command);
+}
+
+void RagdollCommandBuffer::ClearBodyFlag(NxActor* pActor, NxBodyFlag flag, const void* pOwner)
+{
+	Command command;
+	command.type = RagdollCommandType::CommandClearBodyFlag;
+	command.pOwner = pOwner;
+	command.pActor = pActor;
+	command.flag = flag;
+	Record(command);
+}
+
+void RagdollCommandBuffer::RaiseActorFlag(NxActor* pActor, NxActorFlag flag, const void* pOwner)
+{
+	Command command;
+	command.type = RagdollCommandType::CommandRaiseActorFlag;
+	command.pOwner = pOwner;
+	command.pActor = pActor;
+	command.flag = flag;
+	Record(command);
+}
+
+void RagdollCommandBuffer::ClearActorFlag(NxActor* pActor, NxActorFlag flag, const void* pOwner)
+{
+	Command command;
+	command.type = RagdollCommandType::CommandClearActorFlag;
+	command.pOwner = pOwner;
+	command.pActor = pActor;
+	command.flag = flag;
+	Record(command);
+}
+
+void RagdollCommandBuffer::WakeUp(NxActor* pActor, const void* pOwner)
+{
+	Command command;
+	command.type = RagdollCommandType::CommandWakeUp;
+	command.pOwner = pOwner;
+	command.pActor = pActor;
+	Record(command);
+}
+
+void RagdollCommandBuffer::PutToSleep(NxActor* pActor, const void* pOwner)
+{
+	Command command;
+	command.type = RagdollCommandType::CommandPutToSleep;
+	command.pOwner = pOwner;
+	command.pActor = pActor;
+	Record(command);
+}
+
+void RagdollCommandBuffer::SetSolverIterationCount(NxActor* pActor, NxU32 iterations, const void* pOwner)
+{
+	Command command;
+	command.type = RagdollCommandType::CommandSetSolverIterationCount;
+	command.pOwner = pOwner;
+	command.pActor = pActor;
+	command.flag = iterations;
+	Record(command);
+}
+
+void RagdollCommandBuffer::SetContactReportThreshold(NxActor* pActor, NxReal threshold, const void* pOwner)
+{
+	Command command;
+	command.type = RagdollCommandType::CommandSetContactReportThreshold;
+	command.pOwner = pOwner;
+	command.pActor = pActor;
+	command.value = threshold;
+	Record(command);
+}
+
+void RagdollCommandBuffer::SetContactReportFlags(NxActor* pActor, NxU32 flags, const void* pOwner)
+{
+	Command command;
+	command.type = RagdollCommandType::CommandSetContactReportFlags;
+	command.pOwner = pOwner;
+	command.pActor = pActor;
+	command.flag = flags;
+	Record(command);
+}
+
+void RagdollCommandBuffer::CreateJoint(NxScene* pScene, const NxSphericalJointDesc& desc, const JointCreatedCallback& onCreated, const void* pOwner)
+{
+	JointCreation joint;
+	joint.pScene = pScene;
+	joint.type = JointType::spherical;
+	joint.sphericalDesc = desc;
+	joint.onCreated = onCreated;
+	RecordJoint(joint, pOwner);
+}
+
+void RagdollCommandBuffer::CreateJoint(NxScene* pScene, const NxRevoluteJointDesc& desc, const JointCreatedCallback& onCreated, const void* pOwner)
+{
+	JointCreation joint;
+	joint.pScene = pScene;
+	joint.type = JointType::revolute;
+	joint.revoluteDesc = desc;
+	joint.onCreated = onCreated;
+	RecordJoint(joint, pOwner);
+}
+
+void RagdollCommandBuffer::Record(Command& command)
+{
+	//Applied right away when not recording, and by callbacks during the flush
+	if(!m_bRecording || m_bFlushing)
+	{
+		Apply(command, nullptr);
+		return;
+	}
+
+	UINT thread = RagdollJobSystem::GetThreadIndex();
+	ASSERT(thread < m_vBuffers.size(), _T("RagdollCommandBuffer: thread without buffer, start the job system before recording!"));
+	if(thread >= m_vBuffers.size())
+		return;
+
+	m_vBuffers[thread].commands.push_back(command);
+}
+
+void RagdollCommandBuffer::RecordJoint(JointCreation& joint, const void* pOwner)
+{
+	if(!m_bRecording || m_bFlushing)
+	{
+		Apply(joint);
+		return;
+	}
+
+	UINT thread = RagdollJobSystem::GetThreadIndex();
+	ASSERT(thread < m_vBuffers.size(), _T("RagdollCommandBuffer: thread without buffer, start the job system before recording!"));
+	if(thread >= m_vBuffers.size())
+		return;
+
+	ThreadBuffer& buffer = m_vBuffers[thread];
+	Command command;
+	command.type = RagdollCommandType::CommandCreateJoint;
+	command.pOwner = pOwner;
+	command.pActor = nullptr;
+	command.joint = buffer.joints.size();
+	buffer.joints.push_back(joint);
+	buffer.commands.push_back(command);
+}
+
+void RagdollCommandBuffer::Cancel(const void* pOwner)
+{
+	if(pOwner == nullptr)
+		return;
+
+	//The joints stay in their list, nothing points at them anymore
+	for(auto& buffer : m_vBuffers)
+	{
+		buffer.commands.erase(std::remove_if(buffer.commands.begin(), buffer.commands.end(),
+			[pOwner](const Command& command) { return command.pOwner == pOwner; }), buffer.commands.end());
+	}
+}
+
+void RagdollCommandBuffer::Flush()
+{
+	m_iFlushedLastFrame = 0;
+
+	//Same order every run: thread by thread, in the order they were recorded
+	m_bFlushing = true;
+	for(auto& buffer : m_vBuffers)
+	{
+		for(const auto& command : buffer.commands)
+			Apply(command, &buffer.joints);
+		m_iFlushedLastFrame += buffer.commands.size();
+	}
+	m_bFlushing = false;
+
+	for(auto& buffer : m_vBuffers)
+	{
+		buffer.commands.clear();
+		buffer.joints.clear();
+	}
+
+	//The job system could have been restarted with another amount of workers
+	ResizeBuffers();
+}
+
+void RagdollCommandBuffer::Apply(const Command& command, std::vector<JointCreation>* pJoints)
+{
+	NxActor* pActor = command.pActor;
+	switch(command.type)
+	{
+	case RagdollCommandType::CommandSetGlobalPose:
+		pActor->setGlobalPose(command.pose);
+		break;
+	case RagdollCommandType::CommandSetLinearVelocity:
+		pActor->setLinearVelocity(command.vector);
+		break;
+	case RagdollCommandType::CommandSetAngularVelocity:
+		pActor->setAngularVelocity(command.vector);
+		break;
+	case RagdollCommandType::CommandRaiseBodyFlag:
+		pActor->raiseBodyFlag((NxBodyFlag)command.flag);
+		break;
+	case RagdollCommandType::CommandClearBodyFlag:
+		pActor->clearBodyFlag((NxBodyFlag)command.flag);
+		break;
+	case RagdollCommandType::CommandRaiseActorFlag:
+		pActor->raiseActorFlag((NxActorFlag)command.flag);
+		break;
+	case RagdollCommandType::CommandClearActorFlag:
+		pActor->clearActorFlag((NxActorFlag)command.flag);
+		break;
+	case RagdollCommandType::CommandWakeUp:
+		pActor->wakeUp();
+		break;
+	case RagdollCommandType::CommandPutToSleep:
+		pActor->putToSleep();
+		break;
+	case RagdollCommandType::CommandCreateJoint:
+		if(pJoints != nullptr)
+			Apply((*pJoints)[command.joint]);
+		break;
+	case RagdollCommandType::CommandSetSolverIterationCount:
+		pActor->setSolverIterationCount(command.flag);
+		break;
+	case RagdollCommandType::CommandSetContactReportThreshold:
+		pActor->setContactReportThreshold(command.value);
+		break;
+	case RagdollCommandType::CommandSetContactReportFlags:
+		pActor->setContactReportFlags(command.flag);
+		break;
+	}
+}
+
+void RagdollCommandBuffer::Apply(JointCreation& joint)
+{
+	NxJoint* pJoint = nullptr;
+	if(joint.type == JointType::spherical)
+		pJoint = joint.pScene->createJoint(joint.sphericalDesc);
+	else
+		pJoint = joint.pScene->createJoint(joint.revoluteDesc);
+
+	if(joint.onCreated)
+		joint.onCreated(pJoint);
+}
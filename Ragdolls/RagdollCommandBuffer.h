@@ -0,0 +1,134 @@
+#ifndef RAGDOLLCOMMANDBUFFER_H_INCLUDED_
+#define RAGDOLLCOMMANDBUFFER_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// RagdollCommandBuffer: records the PhysX scene writes of the ragdolls (poses, velocities,
+// flags, sleeping, joints, solver and contact report settings) in a buffer per thread and
+// applies them all at one flush point, in a deterministic order, outside the simulate window
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include "../../../OverlordEngine/OverlordComponents.h"
+#include "../Ragdolls/RagdollHelper.h"
+#include <vector>
+#include <functional>
+
+enum RagdollCommandType
+{
+	CommandSetGlobalPose,
+	CommandSetLinearVelocity,
+	CommandSetAngularVelocity,
+	CommandRaiseBodyFlag,
+	CommandClearBodyFlag,
+	CommandRaiseActorFlag,
+	CommandClearActorFlag,
+	CommandWakeUp,
+	CommandPutToSleep,
+	CommandCreateJoint,
+	CommandSetSolverIterationCount,
+	CommandSetContactReportThreshold,
+	CommandSetContactReportFlags
+};
+
+class RagdollCommandBuffer final
+{
+public:
+	static RagdollCommandBuffer* GetInstance();
+	static void DestroyInstance();
+
+	//Gets the joint once it is created (nullptr if PhysX refused it)
+	typedef std::function<void(NxJoint* pJoint)> JointCreatedCallback;
+
+	//METHODS
+	//The scene writes. While recording they go in the buffer of the calling thread,
+	//otherwise they are applied right away (game thread only then!).
+	//The owner is only used to cancel the commands of an object that dies before the flush.
+	void SetGlobalPose(NxActor* pActor, const NxMat34& pose, const void* pOwner = nullptr);
+	void SetLinearVelocity(NxActor* pActor, const NxVec3& velocity, const void* pOwner = nullptr);
+	void SetAngularVelocity(NxActor* pActor, const NxVec3& velocity, const void* pOwner = nullptr);
+	void RaiseBodyFlag(NxActor* pActor, NxBodyFlag flag, const void* pOwner = nullptr);
+	void ClearBodyFlag(NxActor* pActor, NxBodyFlag flag, const void* pOwner = nullptr);
+	void RaiseActorFlag(NxActor* pActor, NxActorFlag flag, const void* pOwner = nullptr);
+	void ClearActorFlag(NxActor* pActor, NxActorFlag flag, const void* pOwner = nullptr);
+	void WakeUp(NxActor* pActor, const void* pOwner = nullptr);
+	void PutToSleep(NxActor* pActor, const void* pOwner = nullptr);
+	void SetSolverIterationCount(NxActor* pActor, NxU32 iterations, const void* pOwner = nullptr);
+	void SetContactReportThreshold(NxActor* pActor, NxReal threshold, const void* pOwner = nullptr);
+	void SetContactReportFlags(NxActor* pActor, NxU32 flags, const void* pOwner = nullptr);
+	void CreateJoint(NxScene* pScene, const NxSphericalJointDesc& desc, const JointCreatedCallback& onCreated, const void* pOwner = nullptr);
+	void CreateJoint(NxScene* pScene, const NxRevoluteJointDesc& desc, const JointCreatedCallback& onCreated, const void* pOwner = nullptr);
+
+	//Drops the recorded commands of this owner (destroyed before the flush)
+	void Cancel(const void* pOwner);
+	//Applies all recorded commands, thread by thread in the order they were recorded. Jobs of the
+	//RagdollJobSystem never touch PhysX, so everything is recorded on the game thread and the order
+	//is that of the game code. Game thread only, after fetchResults and before the next simulate,
+	//and before RagdollReleaseQueue::Update.
+	void Flush();
+
+	//SETTERS
+	//Off by default: every write is applied right away. Only turn it on when the scene calls Flush every frame.
+	void SetRecording(bool recording);
+
+	//GETTERS
+	bool IsRecording() const {return m_bRecording;};
+	//Amount of commands applied by the last Flush
+	UINT GetFlushedLastFrame() const {return m_iFlushedLastFrame;};
+
+private:
+	RagdollCommandBuffer(void);
+	~RagdollCommandBuffer(void);
+
+	static RagdollCommandBuffer* m_pInstance;
+
+	struct Command
+	{
+		RagdollCommandType type;
+		const void* pOwner;
+		NxActor* pActor;
+		NxMat34 pose; //SetGlobalPose
+		NxVec3 vector; //Velocities
+		NxU32 flag; //Body or actor flag, solver iterations, contact report flags
+		NxReal value; //Contact report threshold
+		UINT joint; //CreateJoint: index in the joints of the thread
+	};
+
+	struct JointCreation
+	{
+		NxScene* pScene;
+		JointType type;
+		NxSphericalJointDesc sphericalDesc;
+		NxRevoluteJointDesc revoluteDesc;
+		JointCreatedCallback onCreated;
+	};
+
+	//One per thread (game thread first, then the workers of the RagdollJobSystem).
+	//Only its own thread writes in it until the flush.
+	struct ThreadBuffer
+	{
+		std::vector<Command> commands;
+		std::vector<JointCreation> joints;
+	};
+	std::vector<ThreadBuffer> m_vBuffers;
+
+	bool m_bRecording;
+	bool m_bFlushing; //Callbacks during the flush apply their writes right away
+	UINT m_iFlushedLastFrame;
+
+	//METHODS
+	//Recording: a command in the buffer of this thread. Otherwise it's applied right away.
+	void Record(Command& command);
+	void RecordJoint(JointCreation& joint, const void* pOwner);
+	//Makes room for the game thread and all workers
+	void ResizeBuffers();
+	static void Apply(const Command& command, std::vector<JointCreation>* pJoints);
+	static void Apply(JointCreation& joint);
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	RagdollCommandBuffer(const RagdollCommandBuffer& yRef);
+	RagdollCommandBuffer& operator=(const RagdollCommandBuffer& yRef);
+};
+#endif
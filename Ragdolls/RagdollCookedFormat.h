@@ -0,0 +1,52 @@
+#ifndef RAGDOLLCOOKEDFORMAT_H_INCLUDED_
+#define RAGDOLLCOOKEDFORMAT_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// Binary (cooked) ragdoll definition format. The records are used in place at runtime,
+// straight from the memory mapped file.
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+
+//Layout of a cooked file:
+//[RagdollBlobHeader][RagdollBoneRecord * amountBones][RagdollJointRecord * amountJoints]
+//All values are little endian, 4 byte aligned. Bump the version when changing any record.
+const UINT RAGDOLL_BLOB_MAGIC = 0x4C444752; //'RGDL'
+const UINT RAGDOLL_BLOB_VERSION = 1;
+const UINT RAGDOLL_MAX_BONE_NAME = 32;
+
+struct RagdollBlobHeader
+{
+	UINT magic;
+	UINT version;
+	UINT blobSize; //Size of the whole blob, header included
+	UINT checksum; //FNV-1a of everything after the header
+	UINT amountBones;
+	UINT boneTableOffset; //From the start of the blob
+	UINT amountJoints;
+	UINT jointTableOffset; //From the start of the blob
+};
+
+struct RagdollBoneRecord
+{
+	char name[RAGDOLL_MAX_BONE_NAME]; //ASCII, zero terminated name of the mesh bone we map to
+	UINT shapeType; //RagdollShapeType
+	float height; //the height of the shape if it has any
+	float radius; //the radius for the shape
+};
+
+struct RagdollJointRecord
+{
+	UINT jointType; //JointType
+	UINT bone1; //slot of the first bone
+	UINT bone2; //slot of the second bone
+	UINT anchorBone; //JointBone
+	float axis[3]; //normalized axis in model space (bind pose)
+	float twistLow, twistHigh; //twist limits in radians (spherical)
+	float swingLimit; //swing limit in radians (spherical)
+};
+
+//Default limits, the values the ragdolls were tuned with
+const float RAGDOLL_DEFAULT_TWIST_LIMIT = 0.025f * 3.14159265f;
+const float RAGDOLL_DEFAULT_SWING_LIMIT = 0.25f * 3.14159265f;
+#endif
\ No newline at end of file
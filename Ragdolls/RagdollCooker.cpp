@@ -0,0 +1,279 @@
+//--------------------------------------------------------------------------------------
+// RagdollCooker: turns an authored ragdoll setup (xml or code) into the cooked binary
+// format that the runtime uses in place (see RagdollCookedFormat.h)
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "RagdollCooker.h"
+#include "../../../OverlordEngine/Diagnostics/Logger.h"
+
+#include "../../SZS_Tools/PugiXML/pugixml.hpp"
+
+RagdollCooker::RagdollCooker(void)
+{
+}
+
+RagdollCooker::~RagdollCooker(void)
+{
+	m_vBoneLayouts.clear();
+	m_vJoints.clear();
+}
+
+void RagdollCooker::AddBone(const PhysxBoneLayout& boneLayout)
+{
+	m_vBoneLayouts.push_back(boneLayout);
+}
+
+void RagdollCooker::AddJoint(JointType jointType, const tstring& bone1Name, const tstring& bone2Name,
+	JointBone anchorBone, const NxVec3& axisOrientation, float twistLow, float twistHigh, float swingLimit)
+{
+	JointEntry joint;
+	joint.jointType = jointType;
+	joint.bone1Name = bone1Name;
+	joint.bone2Name = bone2Name;
+	joint.anchorBone = anchorBone;
+	joint.axisOrientation = axisOrientation;
+	joint.twistLow = twistLow;
+	joint.twistHigh = twistHigh;
+	joint.swingLimit = swingLimit;
+	m_vJoints.push_back(joint);
+}
+
+bool RagdollCooker::LoadXml(const tstring& path)
+{
+	//Create a document on the stack (RAII)
+	pugi::xml_document doc;
+	//Load a document and see if it has been found
+	pugi::xml_parse_result result = doc.load_file(path.c_str());
+	if(!result)
+	{
+		Logger::Log(_T("RagdollCooker: Could not load skeleton file ") + path, LogLevel::Error);
+		return false;
+	}
+
+	//Root Node
+	pugi::xml_node rs = doc.child(_T("RagdollSkeleton"));
+
+	//---------------------------------------------------------
+	//Load BoneLayouts
+	pugi::xml_node boneLayouts = rs.child(_T("BoneLayouts"));
+
+	for(pugi::xml_node node = boneLayouts.child(_T("Bone")); node != nullptr; node = node.next_sibling(_T("Bone")))
+	{
+		PhysxBoneLayout boneLayout;
+		boneLayout.name = node.attribute(_T("name")).as_string();
+		boneLayout.height = node.attribute(_T("height")).as_float();
+		boneLayout.radius = node.attribute(_T("radius")).as_float();
+		boneLayout.shapeType = (RagdollShapeType)node.attribute(_T("type")).as_int();
+
+		AddBone(boneLayout);
+	}
+
+	//---------------------------------------------------------
+	//Load BoneJoints
+	pugi::xml_node boneJoints = rs.child(_T("BoneJoints"));
+
+	for(pugi::xml_node node = boneJoints.child(_T("Joint")); node != nullptr; node = node.next_sibling(_T("Joint")))
+	{
+		NxVec3 axisOrietation;
+		axisOrietation.x = node.attribute(_T("axis-x")).as_float();
+		axisOrietation.y = node.attribute(_T("axis-y")).as_float();
+		axisOrietation.z = node.attribute(_T("axis-z")).as_float();
+
+		//Limits are optional
+		float twistLow = node.attribute(_T("twist-low")).as_float(-RAGDOLL_DEFAULT_TWIST_LIMIT);
+		float twistHigh = node.attribute(_T("twist-high")).as_float(RAGDOLL_DEFAULT_TWIST_LIMIT);
+		float swingLimit = node.attribute(_T("swing")).as_float(RAGDOLL_DEFAULT_SWING_LIMIT);
+
+		AddJoint((JointType)node.attribute(_T("type")).as_int(),
+			node.attribute(_T("bone1")).as_string(), node.attribute(_T("bone2")).as_string(),
+			JointBone::PhysxBone2, axisOrietation, twistLow, twistHigh, swingLimit);
+	}
+
+	return true;
+}
+
+int RagdollCooker::FindBoneSlot(const tstring& name) const
+{
+	for(UINT i=0; i < m_vBoneLayouts.size(); ++i)
+	{
+		if(m_vBoneLayouts[i].name == name)
+			return i;
+	}
+	return -1;
+}
+
+bool RagdollCooker::Cook(vector<BYTE>& blob) const
+{
+	const UINT amountBones = m_vBoneLayouts.size();
+	const UINT amountJoints = m_vJoints.size();
+
+	RagdollBlobHeader header;
+	header.magic = RAGDOLL_BLOB_MAGIC;
+	header.version = RAGDOLL_BLOB_VERSION;
+	header.amountBones = amountBones;
+	header.boneTableOffset = sizeof(RagdollBlobHeader);
+	header.amountJoints = amountJoints;
+	header.jointTableOffset = header.boneTableOffset + amountBones * sizeof(RagdollBoneRecord);
+	header.blobSize = header.jointTableOffset + amountJoints * sizeof(RagdollJointRecord);
+	header.checksum = 0;
+
+	blob.assign(header.blobSize, 0);
+
+	//---------------------------------------------------------
+	//Bone table
+	RagdollBoneRecord* pBones = reinterpret_cast<RagdollBoneRecord*>(&blob[header.boneTableOffset]);
+	for(UINT i=0; i < amountBones; ++i)
+	{
+		const PhysxBoneLayout& boneLayout = m_vBoneLayouts[i];
+		if(boneLayout.name.empty() || boneLayout.name.size() >= RAGDOLL_MAX_BONE_NAME)
+		{
+			Logger::Log(_T("RagdollCooker: Bone name empty or too long: ") + boneLayout.name, LogLevel::Error);
+			return false;
+		}
+		for(UINT c=0; c < boneLayout.name.size(); ++c)
+		{
+			//Names are stored as ASCII
+			if(boneLayout.name[c] <= 0 || boneLayout.name[c] > 127)
+			{
+				Logger::Log(_T("RagdollCooker: Bone name is not ASCII: ") + boneLayout.name, LogLevel::Error);
+				return false;
+			}
+			pBones[i].name[c] = static_cast<char>(boneLayout.name[c]);
+		}
+		pBones[i].shapeType = boneLayout.shapeType;
+		pBones[i].height = boneLayout.height;
+		pBones[i].radius = boneLayout.radius;
+	}
+
+	//---------------------------------------------------------
+	//Joint table
+	RagdollJointRecord* pJoints = reinterpret_cast<RagdollJointRecord*>(&blob[header.jointTableOffset]);
+	for(UINT i=0; i < amountJoints; ++i)
+	{
+		const JointEntry& joint = m_vJoints[i];
+		int bone1 = FindBoneSlot(joint.bone1Name);
+		int bone2 = FindBoneSlot(joint.bone2Name);
+		if(bone1 < 0 || bone2 < 0)
+		{
+			Logger::Log(_T("RagdollCooker: Joint refers to a bone that does not exist!"), LogLevel::Error);
+			return false;
+		}
+
+		NxVec3 axis = joint.axisOrientation;
+		axis.normalize();
+
+		pJoints[i].jointType = joint.jointType;
+		pJoints[i].bone1 = bone1;
+		pJoints[i].bone2 = bone2;
+		pJoints[i].anchorBone = joint.anchorBone;
+		pJoints[i].axis[0] = axis.x;
+		pJoints[i].axis[1] = axis.y;
+		pJoints[i].axis[2] = axis.z;
+		pJoints[i].twistLow = joint.twistLow;
+		pJoints[i].twistHigh = joint.twistHigh;
+		pJoints[i].swingLimit = joint.swingLimit;
+	}
+
+	//---------------------------------------------------------
+	//Header last, so the checksum covers the tables
+	header.checksum = CalculateChecksum(&blob[0] + sizeof(RagdollBlobHeader), header.blobSize - sizeof(RagdollBlobHeader));
+	memcpy(&blob[0], &header, sizeof(RagdollBlobHeader));
+
+	return ValidateBlob(&blob[0], blob.size());
+}
+
+bool RagdollCooker::CookFile(const tstring& xmlPath, const tstring& cookedPath)
+{
+	RagdollCooker cooker;
+	if(!cooker.LoadXml(xmlPath))
+		return false;
+
+	vector<BYTE> blob;
+	if(!cooker.Cook(blob))
+		return false;
+
+	HANDLE hFile = CreateFile(cookedPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(hFile == INVALID_HANDLE_VALUE)
+	{
+		Logger::Log(_T("RagdollCooker: Could not create ") + cookedPath, LogLevel::Error);
+		return false;
+	}
+
+	DWORD written = 0;
+	BOOL succeeded = WriteFile(hFile, &blob[0], blob.size(), &written, NULL);
+	CloseHandle(hFile);
+
+	return succeeded && written == blob.size();
+}
+
+UINT RagdollCooker::CalculateChecksum(const BYTE* pData, UINT size)
+{
+	//FNV-1a
+	UINT hash = 2166136261u;
+	for(UINT i=0; i < size; ++i)
+	{
+		hash ^= pData[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+bool RagdollCooker::ValidateBlob(const BYTE* pBlob, UINT size)
+{
+	if(pBlob == nullptr || size < sizeof(RagdollBlobHeader))
+		return false;
+
+	const RagdollBlobHeader* pHeader = reinterpret_cast<const RagdollBlobHeader*>(pBlob);
+	if(pHeader->magic != RAGDOLL_BLOB_MAGIC)
+	{
+		Logger::Log(_T("RagdollCooker: Not a cooked ragdoll!"), LogLevel::Error);
+		return false;
+	}
+	if(pHeader->version != RAGDOLL_BLOB_VERSION)
+	{
+		Logger::Log(_T("RagdollCooker: Cooked ragdoll has the wrong version, cook it again!"), LogLevel::Error);
+		return false;
+	}
+
+	//Tables must be inside the blob. Offset first, then the amount against the room behind it:
+	//offset + amount * record size can wrap around with a corrupt header.
+	if(pHeader->blobSize != size || pHeader->amountBones == 0
+		|| pHeader->boneTableOffset < sizeof(RagdollBlobHeader) || pHeader->boneTableOffset > size
+		|| pHeader->amountBones > (size - pHeader->boneTableOffset) / sizeof(RagdollBoneRecord)
+		|| pHeader->jointTableOffset < sizeof(RagdollBlobHeader) || pHeader->jointTableOffset > size
+		|| pHeader->amountJoints > (size - pHeader->jointTableOffset) / sizeof(RagdollJointRecord)
+		|| pHeader->boneTableOffset % 4 != 0 || pHeader->jointTableOffset % 4 != 0)
+	{
+		Logger::Log(_T("RagdollCooker: Cooked ragdoll is truncated or corrupt!"), LogLevel::Error);
+		return false;
+	}
+
+	if(CalculateChecksum(pBlob + sizeof(RagdollBlobHeader), size - sizeof(RagdollBlobHeader)) != pHeader->checksum)
+	{
+		Logger::Log(_T("RagdollCooker: Checksum of the cooked ragdoll does not match!"), LogLevel::Error);
+		return false;
+	}
+
+	//Contents of the tables
+	return ValidateTables(reinterpret_cast<const RagdollBoneRecord*>(pBlob + pHeader->boneTableOffset), pHeader->amountBones,
+		reinterpret_cast<const RagdollJointRecord*>(pBlob + pHeader->jointTableOffset), pHeader->amountJoints);
+}
+
+bool RagdollCooker::ValidateTables(const RagdollBoneRecord* pBones, UINT amountBones,
+	const RagdollJointRecord* pJoints, UINT amountJoints)
+{
+	for(UINT i=0; i < amountBones; ++i)
+	{
+		if(pBones[i].name[RAGDOLL_MAX_BONE_NAME-1] != 0 || pBones[i].shapeType > RagdollShapeType::sphere)
+			return false;
+	}
+
+	for(UINT i=0; i < amountJoints; ++i)
+	{
+		if(pJoints[i].bone1 >= amountBones || pJoints[i].bone2 >= amountBones
+			|| pJoints[i].jointType > JointType::revolute || pJoints[i].anchorBone > JointBone::PhysxBone2)
+			return false;
+	}
+
+	return true;
+}
\ No newline at end of file
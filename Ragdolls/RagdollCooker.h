@@ -0,0 +1,66 @@
+#ifndef RAGDOLLCOOKER_H_INCLUDED_
+#define RAGDOLLCOOKER_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// RagdollCooker: turns an authored ragdoll setup (xml or code) into the cooked binary
+// format that the runtime uses in place (see RagdollCookedFormat.h)
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include "../../../OverlordEngine/Helpers/PhysicsHelper.h"
+#include "../Ragdolls/RagdollHelper.h"
+#include "../Ragdolls/RagdollCookedFormat.h"
+#include <vector>
+
+class RagdollCooker final
+{
+public:
+	RagdollCooker(void);
+	~RagdollCooker(void);
+
+	//METHODS
+	//Authoring
+	void AddBone(const PhysxBoneLayout& boneLayout);
+	void AddJoint(JointType jointType, const tstring& bone1Name, const tstring& bone2Name,
+		JointBone anchorBone, const NxVec3& axisOrientation,
+		float twistLow = -RAGDOLL_DEFAULT_TWIST_LIMIT, float twistHigh = RAGDOLL_DEFAULT_TWIST_LIMIT,
+		float swingLimit = RAGDOLL_DEFAULT_SWING_LIMIT);
+	//Reads a GameSkeleton.xml style file
+	bool LoadXml(const tstring& path);
+	//Writes the cooked blob, false if the setup is invalid
+	bool Cook(vector<BYTE>& blob) const;
+
+	//Offline cook step: xml file in, cooked file out
+	static bool CookFile(const tstring& xmlPath, const tstring& cookedPath);
+	//Checks header, version, sizes, checksum and the contents of the tables
+	static bool ValidateBlob(const BYTE* pBlob, UINT size);
+	//Checks the contents of the tables (also used for the compile time layouts)
+	static bool ValidateTables(const RagdollBoneRecord* pBones, UINT amountBones,
+		const RagdollJointRecord* pJoints, UINT amountJoints);
+	static UINT CalculateChecksum(const BYTE* pData, UINT size);
+
+private:
+	struct JointEntry
+	{
+		JointType jointType;
+		tstring bone1Name, bone2Name;
+		JointBone anchorBone;
+		NxVec3 axisOrientation;
+		float twistLow, twistHigh, swingLimit;
+	};
+
+	//DATAMEMBERS
+	vector<PhysxBoneLayout> m_vBoneLayouts;
+	vector<JointEntry> m_vJoints;
+
+	//METHODS
+	int FindBoneSlot(const tstring& name) const;
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	RagdollCooker(const RagdollCooker& yRef);
+	RagdollCooker& operator=(const RagdollCooker& yRef);
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,390 @@
+//--------------------------------------------------------------------------------------
+// RagdollDefinition: immutable ragdoll setup resolved once per model and skeleton file,
+// shared read-only by all the PhysxSkeletons using it in OverlordEngine
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "RagdollDefinition.h"
+#include "../../../OverlordEngine/Managers/PhysicsManager.h"
+#include "../../../OverlordEngine/Diagnostics/Logger.h"
+#include "../Ragdolls/RagdollCooker.h"
+#include "../Ragdolls/MappedFile.h"
+
+RagdollDefinitionCache* RagdollDefinitionCache::m_pInstance = nullptr;
+
+RagdollDefinition::RagdollDefinition(void):
+	m_pMappedFile(nullptr),
+	m_pBoneRecords(nullptr),
+	m_iAmountOfBones(0),
+	m_iLayoutBones(0),
+	m_eLod(RagdollLod::LodFull),
+	m_pFollowerRecords(nullptr),
+	m_iAmountOfFollowers(0)
+{
+}
+
+RagdollDefinition::~RagdollDefinition(void)
+{
+	m_vJoints.clear();
+	m_pBoneRecords = nullptr;
+	m_vCookedBlob.clear();
+	SafeDelete(m_pMappedFile);
+}
+
+RagdollDefinition* RagdollDefinition::CreateHumanoid(MeshFilter* pMeshFilter, RagdollLod lod)
+{
+	//The bones and joints are compile time tables, see RagdollLayout.cpp
+	switch(lod)
+	{
+	case RagdollLod::LodReduced:
+		return CreateFromLayout<HumanoidReducedLayout>(pMeshFilter, lod, HumanoidReducedFollowerTable, HUMANOID_REDUCED_FOLLOWERS);
+	case RagdollLod::LodMinimal:
+		return CreateFromLayout<HumanoidMinimalLayout>(pMeshFilter, lod, HumanoidMinimalFollowerTable, HUMANOID_MINIMAL_FOLLOWERS);
+	default:
+		return CreateFromLayout<HumanoidLayout>(pMeshFilter);
+	}
+}
+
+RagdollDefinition* RagdollDefinition::CreateFromFile(const tstring& path, MeshFilter* pMeshFilter)
+{
+	RagdollDefinition* pDefinition = new RagdollDefinition();
+
+	//The cooked file is used in place, nothing gets parsed or copied
+	pDefinition->m_pMappedFile = new MappedFile();
+	if(pDefinition->m_pMappedFile->Open(path))
+	{
+		if(!pDefinition->LoadBlob(pDefinition->m_pMappedFile->GetData(), pDefinition->m_pMappedFile->GetSize())
+			|| !pDefinition->Resolve(pMeshFilter))
+			SafeDelete(pDefinition);
+
+		return pDefinition;
+	}
+	SafeDelete(pDefinition->m_pMappedFile);
+
+	//No cooked file, cook the xml source in memory
+	tstring xmlPath = path.substr(0, path.find_last_of(_T('.'))) + _T(".xml");
+	Logger::Log(_T("RagdollDefinition: No cooked skeleton ") + path + _T(", cooking ") + xmlPath
+		+ _T(" at runtime. Run RagdollCooker::CookFile offline."), LogLevel::Warning);
+
+	RagdollCooker cooker;
+	if(!cooker.LoadXml(xmlPath) || !cooker.Cook(pDefinition->m_vCookedBlob)
+		|| !pDefinition->LoadBlob(&pDefinition->m_vCookedBlob[0], pDefinition->m_vCookedBlob.size())
+		|| !pDefinition->Resolve(pMeshFilter))
+		SafeDelete(pDefinition);
+
+	return pDefinition;
+}
+
+int RagdollDefinition::FindBoneSlot(BoneNameId nameId) const
+{
+	for(UINT i=0; i < m_iAmountOfBones; ++i)
+	{
+		if(m_iBoneNameIds[i] == nameId)
+			return i;
+	}
+	return -1;
+}
+
+int RagdollDefinition::FindBoneSlot(const tstring& name) const
+{
+	BoneNameId nameId = BoneNameTable::GetInstance()->Find(name);
+	if(nameId == INVALID_BONE_NAME)
+		return -1;
+	return FindBoneSlot(nameId);
+}
+
+int RagdollDefinition::GetSlotOfMeshBone(int meshBoneIndex) const
+{
+	if(meshBoneIndex < 0 || meshBoneIndex >= (int)m_iMeshBoneSlots.GetSize())
+		return -1;
+	return m_iMeshBoneSlots[meshBoneIndex];
+}
+
+bool RagdollDefinition::IsResolvedFor(MeshFilter* pMeshFilter) const
+{
+	if(pMeshFilter == nullptr)
+		return false;
+
+	//The remap tables are sized on the mesh, all indices in them stay inside the pose buffer
+	const vector<Bone>& meshSkeleton = pMeshFilter->GetSkeleton();
+	if(meshSkeleton.size() != m_iMeshBoneSlots.GetSize())
+		return false;
+
+	//Every slot has to find its mesh bone again, under the same name
+	UINT amountFound = 0;
+	for(const auto& bone : meshSkeleton)
+	{
+		for(UINT slot=0; slot < m_iAmountOfBones; ++slot)
+		{
+			if(m_iBoneIndices[slot] != bone.Index)
+				continue;
+			if(BoneNameTable::GetInstance()->Intern(bone.Name) != m_iBoneNameIds[slot])
+				return false;
+			++amountFound;
+		}
+	}
+	return amountFound == m_iAmountOfBones;
+}
+
+bool RagdollDefinition::LoadBlob(const BYTE* pBlob, UINT size)
+{
+	if(!RagdollCooker::ValidateBlob(pBlob, size))
+		return false;
+
+	const RagdollBlobHeader* pHeader = reinterpret_cast<const RagdollBlobHeader*>(pBlob);
+	return LoadTables(reinterpret_cast<const RagdollBoneRecord*>(pBlob + pHeader->boneTableOffset), pHeader->amountBones,
+		reinterpret_cast<const RagdollJointRecord*>(pBlob + pHeader->jointTableOffset), pHeader->amountJoints);
+}
+
+bool RagdollDefinition::LoadTables(const RagdollBoneRecord* pBones, UINT amountBones, const RagdollJointRecord* pJoints, UINT amountJoints)
+{
+	if(!RagdollCooker::ValidateTables(pBones, amountBones, pJoints, amountJoints))
+	{
+		Logger::Log(_T("RagdollDefinition: Invalid bone or joint table!"), LogLevel::Error);
+		return false;
+	}
+
+	m_pBoneRecords = pBones;
+	m_iAmountOfBones = amountBones;
+
+	//Intern the names once, from here on bones are only compared by id
+	m_iBoneNameIds.Resize(m_iAmountOfBones);
+	for(UINT i=0; i < m_iAmountOfBones; ++i)
+		m_iBoneNameIds[i] = BoneNameTable::GetInstance()->Intern(m_pBoneRecords[i].name);
+
+	//The joints get their frames in Resolve, so these are the only thing copied out of the tables
+	m_vJoints.resize(amountJoints);
+	for(UINT i=0; i < amountJoints; ++i)
+	{
+		const RagdollJointRecord& record = pJoints[i];
+		RagdollJointDefinition& joint = m_vJoints[i];
+		joint.jointType = (JointType)record.jointType;
+		joint.bone1 = record.bone1;
+		joint.bone2 = record.bone2;
+		joint.anchorBone = (JointBone)record.anchorBone;
+		joint.axisOrientation = NxVec3(record.axis[0], record.axis[1], record.axis[2]);
+		joint.twistLow = record.twistLow;
+		joint.twistHigh = record.twistHigh;
+		joint.swingLimit = record.swingLimit;
+	}
+
+	return true;
+}
+
+bool RagdollDefinition::Resolve(MeshFilter* pMeshFilter)
+{
+	if(pMeshFilter == nullptr)
+		return false;
+
+	//First check if all the input is correct
+	//For n bones we need n-1 joints
+	const UINT amountBones = m_iAmountOfBones;
+	if(amountBones == 0 || amountBones != m_vJoints.size() + 1)
+	{
+		Logger::Log(_T("RagdollDefinition: Mismatch amount of BoneLayouts and JointLayouts!"), LogLevel::Error);
+		return false;
+	}
+
+	const vector<Bone>& meshSkeleton = pMeshFilter->GetSkeleton();
+	m_iBoneIndices.Resize(amountBones);
+	m_iMeshBoneSlots.Resize(meshSkeleton.size());
+	m_iMeshBoneSlots.Fill(-1);
+	m_matTotalOffsets.Resize(amountBones);
+	m_matInvTotalOffsets.Resize(amountBones);
+
+	//Create matrix that converts the offsetOrientation from PhysX to Max axis
+	//PhysX: 0,0,0 rotation == capsule pointing up
+	//Max: 0,0,0 rotation == capsule pointing right
+	D3DXMATRIX matOrientationMaxToPhysx;
+	D3DXMatrixIdentity(&matOrientationMaxToPhysx);
+	D3DXMatrixRotationYawPitchRoll(&matOrientationMaxToPhysx, 0.0f, 0.0f, (float)D3DXToRadian(-90.0f));
+
+	//Intern the names of the mesh once, so the mapping only compares ids
+	vector<BoneNameId> vMeshBoneNameIds(meshSkeleton.size());
+	for(UINT i=0; i < meshSkeleton.size(); ++i)
+		vMeshBoneNameIds[i] = BoneNameTable::GetInstance()->Intern(meshSkeleton[i].Name);
+
+	//---------------------------------------------------------
+	//Map all the bones
+	for(UINT slot=0; slot < amountBones; ++slot)
+	{
+		//Find the bone we want to map to, by id
+		const Bone* pBone = nullptr;
+		for(UINT i=0; i < meshSkeleton.size(); ++i)
+		{
+			if(vMeshBoneNameIds[i] == m_iBoneNameIds[slot])
+			{
+				pBone = &meshSkeleton[i];
+				break;
+			}
+		}
+		//Check if we found our bone, else there is a mistake with the input
+		if(pBone == nullptr)
+		{
+			Logger::Log(_T("PhysxBone NAME INCORRECT! PhysxBone can not be mapped to a Bone in the Model: ")
+				+ BoneNameTable::GetInstance()->GetName(m_iBoneNameIds[slot]), LogLevel::Error);
+			return false;
+		}
+
+		//Store the remap tables
+		m_iBoneIndices[slot] = pBone->Index;
+		m_iMeshBoneSlots[pBone->Index] = slot;
+		//So the total offset equals rotating the bone like in max and offset it with the data from max
+		m_matTotalOffsets[slot] = matOrientationMaxToPhysx * pBone->Offset;
+		//The offset never changes, so we can store its inverse for the seed mode
+		D3DXMatrixInverse(&m_matInvTotalOffsets[slot], NULL, &m_matTotalOffsets[slot]);
+	}
+
+	//---------------------------------------------------------
+	//Map the followers to their mesh bone and the mesh bone of their driver
+	m_iFollowerBoneIndices.Resize(m_iAmountOfFollowers);
+	m_iFollowerDriverIndices.Resize(m_iAmountOfFollowers);
+	for(UINT i=0; i < m_iAmountOfFollowers; ++i)
+	{
+		BoneNameId followerId = BoneNameTable::GetInstance()->Intern(m_pFollowerRecords[i].follower);
+		int driverSlot = FindBoneSlot(BoneNameTable::GetInstance()->Intern(m_pFollowerRecords[i].driver));
+
+		int followerIndex = -1;
+		for(UINT j=0; j < meshSkeleton.size(); ++j)
+		{
+			if(vMeshBoneNameIds[j] == followerId)
+			{
+				followerIndex = meshSkeleton[j].Index;
+				break;
+			}
+		}
+		if(followerIndex < 0 || driverSlot < 0)
+		{
+			Logger::Log(_T("RagdollDefinition: Follower can not be mapped: ")
+				+ BoneNameTable::GetInstance()->GetName(followerId), LogLevel::Error);
+			return false;
+		}
+
+		m_iFollowerBoneIndices[i] = followerIndex;
+		m_iFollowerDriverIndices[i] = m_iBoneIndices[driverSlot];
+		m_iMeshBoneSlots[followerIndex] = driverSlot;
+	}
+
+	//---------------------------------------------------------
+	//Calculate the joint frames in the local space of both actors, using the bind pose.
+	//This way the joints can be created whatever pose the actors are in.
+	for(auto& joint : m_vJoints)
+	{
+		NxMat34 bindPose[2];
+		PhysicsManager::GetInstance()->DMatToNMat(bindPose[0], m_matTotalOffsets[joint.bone1]);
+		PhysicsManager::GetInstance()->DMatToNMat(bindPose[1], m_matTotalOffsets[joint.bone2]);
+
+		NxVec3 globalAnchor = (joint.anchorBone == JointBone::PhysxBone1) ? bindPose[0].t : bindPose[1].t;
+
+		NxVec3 globalAxis = joint.axisOrientation;
+		globalAxis.normalize();
+		//Any normal perpendicular to the axis will do, as long as both actors use the same one
+		NxVec3 globalNormal = globalAxis.cross(NxVec3(0,0,1));
+		if(globalNormal.magnitudeSquared() < 0.0001f)
+			globalNormal = globalAxis.cross(NxVec3(1,0,0));
+		globalNormal.normalize();
+
+		for(int i=0; i < 2; ++i)
+		{
+			bindPose[i].multiplyByInverseRT(globalAnchor, joint.localAnchor[i]);
+			bindPose[i].M.multiplyByTranspose(globalAxis, joint.localAxis[i]);
+			bindPose[i].M.multiplyByTranspose(globalNormal, joint.localNormal[i]);
+		}
+	}
+
+	return true;
+}
+
+//--------------------------------------------------------------------------------------
+// RagdollDefinitionCache
+//--------------------------------------------------------------------------------------
+RagdollDefinitionCache* RagdollDefinitionCache::GetInstance()
+{
+	if(m_pInstance == nullptr)
+		m_pInstance = new RagdollDefinitionCache();
+	return m_pInstance;
+}
+
+void RagdollDefinitionCache::DestroyInstance()
+{
+	SafeDelete(m_pInstance);
+}
+
+UINT RagdollDefinitionCache::HashSkeleton(MeshFilter* pMeshFilter)
+{
+	if(pMeshFilter == nullptr)
+		return 0;
+
+	//FNV-1a, chained over the bones
+	const vector<Bone>& meshSkeleton = pMeshFilter->GetSkeleton();
+	UINT hash = 2166136261u;
+	for(const auto& bone : meshSkeleton)
+	{
+		const BYTE* pBytes[3] = {reinterpret_cast<const BYTE*>(bone.Name.c_str()),
+			reinterpret_cast<const BYTE*>(&bone.Index), reinterpret_cast<const BYTE*>(&bone.Offset)};
+		const UINT sizes[3] = {bone.Name.size() * sizeof(bone.Name[0]), sizeof(bone.Index), sizeof(bone.Offset)};
+		for(UINT part=0; part < 3; ++part)
+		{
+			for(UINT i=0; i < sizes[part]; ++i)
+			{
+				hash ^= pBytes[part][i];
+				hash *= 16777619u;
+			}
+		}
+	}
+	return hash;
+}
+
+std::shared_ptr<const RagdollDefinition> RagdollDefinitionCache::GetHumanoidDefinition(MeshFilter* pMeshFilter, UINT skeletonHash, RagdollLod lod)
+{
+	static const TCHAR* const lodKeys[RagdollLod::LodCount] = {_T("<Humanoid>"), _T("<Humanoid:Reduced>"), _T("<Humanoid:Minimal>")};
+	DefinitionKey key(lodKeys[lod], skeletonHash);
+	bool collision = false;
+	std::shared_ptr<const RagdollDefinition> pDefinition = Find(key, pMeshFilter, collision);
+	if(pDefinition)
+		return pDefinition;
+
+	pDefinition.reset(RagdollDefinition::CreateHumanoid(pMeshFilter, lod));
+	Store(key, pDefinition, collision);
+	return pDefinition;
+}
+
+std::shared_ptr<const RagdollDefinition> RagdollDefinitionCache::GetDefinition(const tstring& path, MeshFilter* pMeshFilter, UINT skeletonHash)
+{
+	DefinitionKey key(path, skeletonHash);
+	bool collision = false;
+	std::shared_ptr<const RagdollDefinition> pDefinition = Find(key, pMeshFilter, collision);
+	if(pDefinition)
+		return pDefinition;
+
+	pDefinition.reset(RagdollDefinition::CreateFromFile(path, pMeshFilter));
+	Store(key, pDefinition, collision);
+	return pDefinition;
+}
+
+std::shared_ptr<const RagdollDefinition> RagdollDefinitionCache::Find(const DefinitionKey& key, MeshFilter* pMeshFilter, bool& collision) const
+{
+	collision = false;
+	auto it = m_Definitions.find(key);
+	if(it == m_Definitions.end())
+		return nullptr;
+
+	if(it->second->IsResolvedFor(pMeshFilter))
+		return it->second;
+
+	collision = true;
+	return nullptr;
+}
+
+void RagdollDefinitionCache::Store(const DefinitionKey& key, const std::shared_ptr<const RagdollDefinition>& pDefinition, bool collision)
+{
+	if(!pDefinition)
+		return;
+
+	//Two skeletons with the same hash: the first one keeps the entry, this mesh resolves its own every time
+	if(collision)
+	{
+		Logger::Log(_T("RagdollDefinitionCache: Two skeletons share a hash, the definition is not cached"), LogLevel::Warning);
+		return;
+	}
+	m_Definitions[key] = pDefinition;
+}
\ No newline at end of file
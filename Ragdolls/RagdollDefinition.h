@@ -0,0 +1,194 @@
+#ifndef RAGDOLLDEFINITION_H_INCLUDED_
+#define RAGDOLLDEFINITION_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// RagdollDefinition: immutable ragdoll setup resolved once per model and skeleton file,
+// shared read-only by all the PhysxSkeletons using it in OverlordEngine
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include "../../../OverlordEngine/Helpers/D3DUtil.h"
+#include "../../../OverlordEngine/OverlordComponents.h"
+#include "../Ragdolls/RagdollHelper.h"
+#include "../Ragdolls/AlignedBuffer.h"
+#include "../Ragdolls/RagdollCookedFormat.h"
+#include "../Ragdolls/BoneNameTable.h"
+#include "../Ragdolls/RagdollLayout.h"
+#include <vector>
+#include <map>
+#include <memory>
+
+struct RagdollJointDefinition
+{
+	//Constructor to make sure all variables are initialized
+	RagdollJointDefinition(void):
+		jointType(JointType::spherical), bone1(0), bone2(0),
+		anchorBone(JointBone::PhysxBone2), axisOrientation(NxVec3(1,0,0)),
+		twistLow(-RAGDOLL_DEFAULT_TWIST_LIMIT), twistHigh(RAGDOLL_DEFAULT_TWIST_LIMIT),
+		swingLimit(RAGDOLL_DEFAULT_SWING_LIMIT)
+	{
+		for(int i=0; i < 2; ++i)
+		{
+			localAnchor[i] = NxVec3(0,0,0);
+			localAxis[i] = NxVec3(1,0,0);
+			localNormal[i] = NxVec3(0,1,0);
+		}
+	}
+
+	JointType jointType; //type of joint
+	UINT bone1; //slot of PhysxBone 1
+	UINT bone2; //slot of PhysxBone 2
+	JointBone anchorBone; //bone whose position is used as anchor
+	NxVec3 axisOrientation; //normalized vector in model space (bind pose)
+	float twistLow, twistHigh, swingLimit; //limits in radians (spherical)
+
+	//Joint frames in the local space of both actors, calculated from the bind pose
+	NxVec3 localAnchor[2];
+	NxVec3 localAxis[2];
+	NxVec3 localNormal[2];
+};
+
+class MappedFile;
+
+class RagdollDefinition final
+{
+public:
+	RagdollDefinition(void);
+	~RagdollDefinition(void);
+
+	//METHODS
+	//Creates the definitions, nullptr if the input is incorrect
+	static RagdollDefinition* CreateHumanoid(MeshFilter* pMeshFilter, RagdollLod lod = RagdollLod::LodFull);
+	//Uses the compile time tables of the layout in place. Reduced layouts (LOD tiers) pass
+	//the mesh bones they don't simulate as followers.
+	template<typename Layout>
+	static RagdollDefinition* CreateFromLayout(MeshFilter* pMeshFilter, RagdollLod lod = RagdollLod::LodFull,
+		const RagdollFollowerRecord* pFollowers = nullptr, UINT amountFollowers = 0)
+	{
+		RagdollDefinition* pDefinition = new RagdollDefinition();
+		pDefinition->m_eLod = lod;
+		pDefinition->m_pFollowerRecords = pFollowers;
+		pDefinition->m_iAmountOfFollowers = amountFollowers;
+		if(!pDefinition->LoadTables(Layout::BoneTable, Layout::AmountOfBones, Layout::JointTable, Layout::AmountOfJoints)
+			|| !pDefinition->Resolve(pMeshFilter))
+			SafeDelete(pDefinition);
+		else
+			pDefinition->m_iLayoutBones = Layout::AmountOfBones;
+		return pDefinition;
+	}
+	//Maps a cooked .ragdoll file. If there is none, the .xml next to it is cooked in memory.
+	static RagdollDefinition* CreateFromFile(const tstring& path, MeshFilter* pMeshFilter);
+
+	//GETTERS
+	UINT GetAmountOfBones() const {return m_iAmountOfBones;};
+	//Amount of bones of the compile time layout this was built from, 0 for data driven definitions.
+	//Skeletons use it to pick the fixed size update loops.
+	UINT GetLayoutBones() const {return m_iLayoutBones;};
+	UINT GetAmountOfJoints() const {return m_vJoints.size();};
+	//Records are used in place, from the mapped file or the cooked blob
+	const RagdollBoneRecord& GetBoneRecord(UINT slot) const {return m_pBoneRecords[slot];};
+	const RagdollJointDefinition& GetJoint(UINT joint) const {return m_vJoints[joint];};
+	//Interned name of the bone in this slot
+	BoneNameId GetBoneNameId(UINT slot) const {return m_iBoneNameIds[slot];};
+	//Slot of the bone with this name, -1 if it doesn't exist
+	int FindBoneSlot(BoneNameId nameId) const;
+	int FindBoneSlot(const tstring& name) const;
+	//Slot mapped to the mesh bone with this index, -1 if the mesh bone has no PhysxBone.
+	//Followers return the slot of the bone they move with.
+	int GetSlotOfMeshBone(int meshBoneIndex) const;
+	//True if this was resolved against a mesh with this skeleton: same amount of bones,
+	//and every slot maps to a mesh bone with its name
+	bool IsResolvedFor(MeshFilter* pMeshFilter) const;
+	//LOD tier this definition was built for (LodFull for data driven definitions)
+	RagdollLod GetLod() const {return m_eLod;};
+
+	//Followers: mesh bones that get the bone transform of their driver in SeedMode
+	UINT GetAmountOfFollowers() const {return m_iFollowerBoneIndices.GetSize();};
+	const int* GetFollowerBoneIndices() const {return m_iFollowerBoneIndices.GetData();};
+	const int* GetFollowerDriverIndices() const {return m_iFollowerDriverIndices.GetData();};
+
+	//Hot data, one entry per bone slot
+	const int* GetBoneIndices() const {return m_iBoneIndices.GetData();};
+	const D3DXMATRIX* GetTotalOffsets() const {return m_matTotalOffsets.GetData();};
+	const D3DXMATRIX* GetInvTotalOffsets() const {return m_matInvTotalOffsets.GetData();};
+
+private:
+	//DATAMEMBERS
+	//Storage of the cooked blob, either the mapped file or a blob cooked in memory
+	MappedFile* m_pMappedFile;
+	vector<BYTE> m_vCookedBlob;
+
+	const RagdollBoneRecord* m_pBoneRecords; //Points into the blob
+	UINT m_iAmountOfBones;
+	UINT m_iLayoutBones;
+	vector<RagdollJointDefinition> m_vJoints;
+	RagdollLod m_eLod;
+
+	const RagdollFollowerRecord* m_pFollowerRecords; //Static table of the layout, resolved in Resolve
+	UINT m_iAmountOfFollowers;
+
+	AlignedBuffer<BoneNameId> m_iBoneNameIds; //Interned name of every slot
+	AlignedBuffer<int> m_iBoneIndices; //Remap table slot -> mesh bone index
+	AlignedBuffer<int> m_iMeshBoneSlots; //Remap table mesh bone index -> slot (-1 if not mapped)
+	AlignedBuffer<D3DXMATRIX> m_matTotalOffsets; //TotalOffset of the bones based on parents (== bind pose in model space)
+	AlignedBuffer<D3DXMATRIX> m_matInvTotalOffsets; //Inverse of the TotalOffsets
+	AlignedBuffer<int> m_iFollowerBoneIndices; //Mesh bone index of every follower
+	AlignedBuffer<int> m_iFollowerDriverIndices; //Mesh bone index of the bone it moves with
+
+	//METHODS
+	//Validates the blob and points the tables into it, the blob has to outlive the definition
+	bool LoadBlob(const BYTE* pBlob, UINT size);
+	//Same for tables that are not in a blob (compile time layouts)
+	bool LoadTables(const RagdollBoneRecord* pBones, UINT amountBones, const RagdollJointRecord* pJoints, UINT amountJoints);
+	//Maps all bones to the mesh and calculates the offsets and joint frames
+	bool Resolve(MeshFilter* pMeshFilter);
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	RagdollDefinition(const RagdollDefinition& yRef);
+	RagdollDefinition& operator=(const RagdollDefinition& yRef);
+};
+
+//Loads every definition once per skeleton file and mesh skeleton, and hands out shared read-only copies
+class RagdollDefinitionCache final
+{
+public:
+	static RagdollDefinitionCache* GetInstance();
+	static void DestroyInstance();
+
+	//Built-in humanoid setup, in the given LOD tier. The hash is the HashSkeleton of the mesh,
+	//calculated once by the caller for all its tiers.
+	std::shared_ptr<const RagdollDefinition> GetHumanoidDefinition(MeshFilter* pMeshFilter, UINT skeletonHash, RagdollLod lod = RagdollLod::LodFull);
+	//Setup loaded from a skeleton file
+	std::shared_ptr<const RagdollDefinition> GetDefinition(const tstring& path, MeshFilter* pMeshFilter, UINT skeletonHash);
+	//Hash of what Resolve reads from the mesh: the names, indices and offsets of the bones
+	static UINT HashSkeleton(MeshFilter* pMeshFilter);
+	//Drops the cache. Skeletons still using a definition keep it alive.
+	void Clear() {m_Definitions.clear();};
+
+private:
+	RagdollDefinitionCache(void){};
+	~RagdollDefinitionCache(void){};
+
+	static RagdollDefinitionCache* m_pInstance;
+
+	//Keyed on the skeleton of the mesh, not the MeshFilter: a destroyed filter can have its address reused
+	typedef std::pair<tstring, UINT> DefinitionKey;
+	std::map<DefinitionKey, std::shared_ptr<const RagdollDefinition>> m_Definitions;
+
+	//METHODS
+	//Cached definition for the key, if it really was resolved for this mesh (the hash can collide)
+	std::shared_ptr<const RagdollDefinition> Find(const DefinitionKey& key, MeshFilter* pMeshFilter, bool& collision) const;
+	//Caches a new definition, unless its key is taken by another skeleton
+	void Store(const DefinitionKey& key, const std::shared_ptr<const RagdollDefinition>& pDefinition, bool collision);
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	RagdollDefinitionCache(const RagdollDefinitionCache& yRef);
+	RagdollDefinitionCache& operator=(const RagdollDefinitionCache& yRef);
+};
+#endif
\ No newline at end of file
@@ -6,7 +6,6 @@
 //--------------------------------------------------------------------------------------
 #pragma once
 #include "../../../OverlordEngine/Helpers/stdafx.h"
-class PhysxBone;
 
 enum RagdollShapeType
 {
@@ -21,6 +20,31 @@ enum RagdollState
 	SeedState
 };
 
+//Physics LOD tiers, the lower the tier the less bodies (see RagdollLod.h)
+enum RagdollLod
+{
+	LodFull,
+	LodReduced,
+	LodMinimal,
+	LodCount
+};
+
+//Result of the settle detection of a ragdoll in SeedState
+enum RagdollSettleEvent
+{
+	SettleNone,
+	SettleSettled, //Came to rest, the actors are put to sleep
+	SettleWoken //Started moving again
+};
+
+//What the budget scheduler allows a ragdoll in SeedState (see RagdollBudget.h)
+enum RagdollBudgetLevel
+{
+	BudgetSimulated, //Full simulation
+	BudgetDowngraded, //Simulated with the minimum solver iterations
+	BudgetFrozen //Kinematic where it is, the pose is held
+};
+
 enum JointType
 {
 	spherical,
@@ -46,20 +70,4 @@ struct PhysxBoneLayout
 	float height; //the height of the shape if it has any
 	float radius; //the radius for the shape
 };
-
-struct PhysxJointLayout
-{
-	//Constructor to make sure all variables are initialized
-	PhysxJointLayout(void):
-		jointType(JointType::spherical), pBone1(nullptr),
-		pBone2(nullptr), anchorBone(JointBone::PhysxBone1),
-		axisOrientation(NxVec3(1,0,0))
-	{}
-
-	JointType jointType; //type of joint
-	PhysxBone* pBone1; //pointer to physxBone 1
-	PhysxBone* pBone2; //pointer to physxBone 2
-	JointBone anchorBone; //position of the anchor (global)
-	NxVec3 axisOrientation; //normalized vector indicating the axis along we create our joint
-};
 #endif
\ No newline at end of file
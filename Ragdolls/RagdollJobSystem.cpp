@@ -0,0 +1,181 @@
+//--------------------------------------------------------------------------------------
+// RagdollJobSystem: worker threads with a work-stealing deque each, used to run the pose
+// math of all ragdolls in parallel chunks. Jobs never touch PhysX, the PhysX reads and
+// writes stay on the calling thread.
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "RagdollJobSystem.h"
+
+RagdollJobSystem* RagdollJobSystem::m_pInstance = nullptr;
+
+//Set once by every worker when it starts
+static __declspec(thread) UINT g_iThreadIndex = 0;
+
+RagdollJobSystem::RagdollJobSystem(void):
+	m_iQueuedChunks(0),
+	m_bStopping(false),
+	m_iAmountStolen(0)
+{
+}
+
+RagdollJobSystem::~RagdollJobSystem(void)
+{
+	Stop();
+}
+
+RagdollJobSystem* RagdollJobSystem::GetInstance()
+{
+	if(m_pInstance == nullptr)
+		m_pInstance = new RagdollJobSystem();
+	return m_pInstance;
+}
+
+void RagdollJobSystem::DestroyInstance()
+{
+	SafeDelete(m_pInstance);
+}
+
+UINT RagdollJobSystem::GetAmountRunningWorkers()
+{
+	return (m_pInstance != nullptr) ? m_pInstance->GetAmountWorkers() : 0;
+}
+
+void RagdollJobSystem::Start(UINT amountWorkers)
+{
+	Stop();
+
+	if(amountWorkers == 0)
+	{
+		UINT cores = std::thread::hardware_concurrency();
+		amountWorkers = (cores > 1) ? cores - 1 : 0;
+	}
+
+	m_bStopping = false;
+	for(UINT i=0; i <= amountWorkers; ++i)
+		m_vpQueues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+	for(UINT i=0; i < amountWorkers; ++i)
+		m_vWorkers.push_back(std::thread(&RagdollJobSystem::WorkerLoop, this, i));
+}
+
+void RagdollJobSystem::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_WakeMutex);
+		m_bStopping = true;
+	}
+	m_WakeCondition.notify_all();
+
+	for(auto& worker : m_vWorkers)
+		worker.join();
+	m_vWorkers.clear();
+	m_vpQueues.clear();
+	m_iQueuedChunks = 0;
+}
+
+void RagdollJobSystem::ParallelFor(UINT count, UINT chunkSize, const RangeJob& job)
+{
+	if(count == 0)
+		return;
+	if(chunkSize == 0)
+		chunkSize = 1;
+
+	//Not worth waking anyone
+	if(m_vWorkers.empty() || count <= chunkSize)
+	{
+		job(0, count);
+		return;
+	}
+
+	UINT amountChunks = (count + chunkSize - 1) / chunkSize;
+	std::atomic<UINT> remaining(amountChunks);
+
+	//Deal the chunks round robin over all deques, ours included, stealing evens it out
+	const UINT amountQueues = m_vpQueues.size();
+	for(UINT i=0; i < amountChunks; ++i)
+	{
+		Chunk chunk = {&job, i * chunkSize, min((i + 1) * chunkSize, count), &remaining};
+		WorkQueue& queue = *m_vpQueues[i % amountQueues];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.chunks.push_back(chunk);
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_WakeMutex);
+		m_iQueuedChunks += amountChunks;
+	}
+	m_WakeCondition.notify_all();
+
+	//Help until our chunks are done, wherever they ended up
+	const UINT ownQueue = amountQueues - 1;
+	Chunk chunk;
+	while(remaining > 0)
+	{
+		if(PopOrSteal(ownQueue, chunk))
+			Run(chunk);
+		else
+			std::this_thread::yield();
+	}
+}
+
+UINT RagdollJobSystem::GetThreadIndex()
+{
+	return g_iThreadIndex;
+}
+
+void RagdollJobSystem::WorkerLoop(UINT queueIndex)
+{
+	g_iThreadIndex = queueIndex + 1;
+
+	Chunk chunk;
+	for(;;)
+	{
+		if(PopOrSteal(queueIndex, chunk))
+		{
+			Run(chunk);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_WakeMutex);
+		m_WakeCondition.wait(lock, [this]() { return m_bStopping || m_iQueuedChunks > 0; });
+		if(m_bStopping)
+			return;
+	}
+}
+
+bool RagdollJobSystem::PopOrSteal(UINT queueIndex, Chunk& chunk)
+{
+	//Our own deque first, newest chunk
+	{
+		WorkQueue& queue = *m_vpQueues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if(!queue.chunks.empty())
+		{
+			chunk = queue.chunks.back();
+			queue.chunks.pop_back();
+			--m_iQueuedChunks;
+			return true;
+		}
+	}
+
+	//Steal the oldest chunk of someone else
+	const UINT amountQueues = m_vpQueues.size();
+	for(UINT i=1; i < amountQueues; ++i)
+	{
+		WorkQueue& queue = *m_vpQueues[(queueIndex + i) % amountQueues];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if(!queue.chunks.empty())
+		{
+			chunk = queue.chunks.front();
+			queue.chunks.pop_front();
+			--m_iQueuedChunks;
+			++m_iAmountStolen;
+			return true;
+		}
+	}
+	return false;
+}
+
+void RagdollJobSystem::Run(const Chunk& chunk)
+{
+	(*chunk.pJob)(chunk.begin, chunk.end);
+	--(*chunk.pRemaining);
+}
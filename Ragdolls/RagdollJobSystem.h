@@ -0,0 +1,94 @@
+#ifndef RAGDOLLJOBSYSTEM_H_INCLUDED_
+#define RAGDOLLJOBSYSTEM_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// RagdollJobSystem: worker threads with a work-stealing deque each, used to run the pose
+// math of all ragdolls in parallel chunks. Jobs never touch PhysX, the PhysX reads and
+// writes stay on the calling thread.
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+class RagdollJobSystem final
+{
+public:
+	static RagdollJobSystem* GetInstance();
+	static void DestroyInstance();
+
+	//Handles the items [begin, end)
+	typedef std::function<void(UINT begin, UINT end)> RangeJob;
+
+	//METHODS
+	//Splits [0, count) in chunks of chunkSize items and runs them on the workers, the calling
+	//thread helps. Returns when all chunks are done. Only call from the game thread.
+	void ParallelFor(UINT count, UINT chunkSize, const RangeJob& job);
+	//(Re)starts the workers. 0 == one less than the amount of cores, the calling thread is the last one.
+	//Nothing is started before this is called (the RagdollUpdateBatch does when it is enabled).
+	void Start(UINT amountWorkers = 0);
+	//Stops and joins the workers, ParallelFor runs everything on the calling thread then
+	void Stop();
+
+	//GETTERS
+	UINT GetAmountWorkers() const {return m_vWorkers.size();};
+	bool IsStarted() const {return !m_vpQueues.empty();};
+	//Same as GetAmountWorkers, without creating the instance (0 if there is none)
+	static UINT GetAmountRunningWorkers();
+	//0 on the game thread (and any thread that isn't ours), 1 to GetAmountWorkers() on the workers
+	static UINT GetThreadIndex();
+	//Chunks that were taken from the deque of another thread, since the last ResetStatistics
+	UINT GetAmountStolen() const {return m_iAmountStolen;};
+	void ResetStatistics() {m_iAmountStolen = 0;};
+
+private:
+	RagdollJobSystem(void);
+	~RagdollJobSystem(void);
+
+	static RagdollJobSystem* m_pInstance;
+
+	struct Chunk
+	{
+		const RangeJob* pJob;
+		UINT begin, end;
+		std::atomic<UINT>* pRemaining; //Chunks of this ParallelFor that aren't done yet
+	};
+
+	//The owner takes from the back, thieves from the front
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Chunk> chunks;
+	};
+
+	//One per worker, the last one belongs to the calling thread
+	std::vector<std::unique_ptr<WorkQueue>> m_vpQueues;
+	std::vector<std::thread> m_vWorkers;
+
+	//Idle workers sleep until chunks are queued
+	std::mutex m_WakeMutex;
+	std::condition_variable m_WakeCondition;
+	std::atomic<UINT> m_iQueuedChunks;
+	std::atomic<bool> m_bStopping;
+
+	std::atomic<UINT> m_iAmountStolen;
+
+	//METHODS
+	void WorkerLoop(UINT queueIndex);
+	bool PopOrSteal(UINT queueIndex, Chunk& chunk);
+	static void Run(const Chunk& chunk);
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	RagdollJobSystem(const RagdollJobSystem& yRef);
+	RagdollJobSystem& operator=(const RagdollJobSystem& yRef);
+};
+#endif
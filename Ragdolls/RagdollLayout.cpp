@@ -0,0 +1,123 @@
+//--------------------------------------------------------------------------------------
+// RagdollLayout: compile time bone and joint tables for the ragdoll archetypes we know
+// up front (the zombie and its LOD tiers)
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "RagdollLayout.h"
+#include "../Ragdolls/RagdollHelper.h"
+
+//---------------------------------------------------------
+//Humanoid
+//{name, shapeType, height, radius}
+template<>
+const RagdollBoneRecord HumanoidLayout::BoneTable[HumanoidLayout::AmountOfBones] =
+{
+	{"Spine0", RagdollShapeType::capsule, 0.15f, 0.2f}, //Bone 1
+	{"Spine1", RagdollShapeType::capsule, 0.025f, 0.45f}, //Bone 2
+	{"Head", RagdollShapeType::sphere, 5.0f, 0.65f}, //Bone 3
+	{"RightUpperArm", RagdollShapeType::capsule, 0.35f, 0.15f}, //Bone 4
+	{"RightLowerArm", RagdollShapeType::capsule, 0.35f, 0.15f}, //Bone 5
+	{"LeftUpperArm", RagdollShapeType::capsule, 0.35f, 0.15f}, //Bone 6
+	{"LeftLowerArm", RagdollShapeType::capsule, 0.35f, 0.15f}, //Bone 7
+	{"RightUpperLeg", RagdollShapeType::capsule, 0.3f, 0.2f}, //Bone 8
+	{"RightLowerLeg", RagdollShapeType::capsule, 0.5f, 0.2f}, //Bone 9
+	{"LeftUpperLeg", RagdollShapeType::capsule, 0.3f, 0.2f}, //Bone 10
+	{"LeftLowerLeg", RagdollShapeType::capsule, 0.5f, 0.2f} //Bone 11
+};
+
+//The axis is in global space (bind pose) and normalized.
+//{jointType, bone1, bone2, anchorBone, axis, twistLow, twistHigh, swingLimit}
+template<>
+const RagdollJointRecord HumanoidLayout::JointTable[HumanoidLayout::AmountOfJoints] =
+{
+	{JointType::spherical, 0, 1, JointBone::PhysxBone2, {0.0f, 1.0f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT}, //Joint 1
+	{JointType::spherical, 1, 2, JointBone::PhysxBone2, {0.0f, 1.0f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT}, //Joint 2
+	{JointType::spherical, 1, 3, JointBone::PhysxBone2, {-0.32197f, -0.946653f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT}, //Joint 3
+	{JointType::spherical, 3, 4, JointBone::PhysxBone2, {-0.32197f, -0.946653f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT}, //Joint 4 (rev)
+	{JointType::spherical, 1, 5, JointBone::PhysxBone2, {0.285960f, -0.9582864f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT}, //Joint 5
+	{JointType::spherical, 5, 6, JointBone::PhysxBone2, {0.285960f, -0.9582864f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT}, //Joint 6 (rev)
+	{JointType::spherical, 0, 7, JointBone::PhysxBone2, {0.0f, -1.0f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT}, //Joint 7
+	{JointType::spherical, 7, 8, JointBone::PhysxBone2, {0.0f, -1.0f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT}, //Joint 8 (rev)
+	{JointType::spherical, 0, 9, JointBone::PhysxBone2, {0.0f, -1.0f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT}, //Joint 9
+	{JointType::spherical, 9, 10, JointBone::PhysxBone2, {0.0f, -1.0f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT} //Joint 10 (rev)
+};
+
+//---------------------------------------------------------
+//Humanoid, reduced: the upper limb bodies cover the whole limb
+template<>
+const RagdollBoneRecord HumanoidReducedLayout::BoneTable[HumanoidReducedLayout::AmountOfBones] =
+{
+	{"Spine0", RagdollShapeType::capsule, 0.15f, 0.2f}, //Bone 1
+	{"Spine1", RagdollShapeType::capsule, 0.025f, 0.45f}, //Bone 2
+	{"RightUpperArm", RagdollShapeType::capsule, 0.85f, 0.15f}, //Bone 3
+	{"LeftUpperArm", RagdollShapeType::capsule, 0.85f, 0.15f}, //Bone 4
+	{"RightUpperLeg", RagdollShapeType::capsule, 0.95f, 0.2f}, //Bone 5
+	{"LeftUpperLeg", RagdollShapeType::capsule, 0.95f, 0.2f} //Bone 6
+};
+
+template<>
+const RagdollJointRecord HumanoidReducedLayout::JointTable[HumanoidReducedLayout::AmountOfJoints] =
+{
+	{JointType::spherical, 0, 1, JointBone::PhysxBone2, {0.0f, 1.0f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT}, //Joint 1
+	{JointType::spherical, 1, 2, JointBone::PhysxBone2, {-0.32197f, -0.946653f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT}, //Joint 2
+	{JointType::spherical, 1, 3, JointBone::PhysxBone2, {0.285960f, -0.9582864f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT}, //Joint 3
+	{JointType::spherical, 0, 4, JointBone::PhysxBone2, {0.0f, -1.0f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT}, //Joint 4
+	{JointType::spherical, 0, 5, JointBone::PhysxBone2, {0.0f, -1.0f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT} //Joint 5
+};
+
+//{follower, driver}
+const RagdollFollowerRecord HumanoidReducedFollowerTable[HUMANOID_REDUCED_FOLLOWERS] =
+{
+	{"Head", "Spine1"},
+	{"RightLowerArm", "RightUpperArm"},
+	{"LeftLowerArm", "LeftUpperArm"},
+	{"RightLowerLeg", "RightUpperLeg"},
+	{"LeftLowerLeg", "LeftUpperLeg"}
+};
+
+//---------------------------------------------------------
+//Humanoid, minimal: pelvis, chest and head, the limbs move with the torso
+template<>
+const RagdollBoneRecord HumanoidMinimalLayout::BoneTable[HumanoidMinimalLayout::AmountOfBones] =
+{
+	{"Spine0", RagdollShapeType::capsule, 0.15f, 0.45f}, //Bone 1
+	{"Spine1", RagdollShapeType::capsule, 0.025f, 0.6f}, //Bone 2
+	{"Head", RagdollShapeType::sphere, 5.0f, 0.65f} //Bone 3
+};
+
+template<>
+const RagdollJointRecord HumanoidMinimalLayout::JointTable[HumanoidMinimalLayout::AmountOfJoints] =
+{
+	{JointType::spherical, 0, 1, JointBone::PhysxBone2, {0.0f, 1.0f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT}, //Joint 1
+	{JointType::spherical, 1, 2, JointBone::PhysxBone2, {0.0f, 1.0f, 0.0f},
+		-RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_TWIST_LIMIT, RAGDOLL_DEFAULT_SWING_LIMIT} //Joint 2
+};
+
+//{follower, driver}
+const RagdollFollowerRecord HumanoidMinimalFollowerTable[HUMANOID_MINIMAL_FOLLOWERS] =
+{
+	{"RightUpperArm", "Spine1"},
+	{"RightLowerArm", "Spine1"},
+	{"LeftUpperArm", "Spine1"},
+	{"LeftLowerArm", "Spine1"},
+	{"RightUpperLeg", "Spine0"},
+	{"RightLowerLeg", "Spine0"},
+	{"LeftUpperLeg", "Spine0"},
+	{"LeftLowerLeg", "Spine0"}
+};
@@ -0,0 +1,55 @@
+#ifndef RAGDOLLLAYOUT_H_INCLUDED_
+#define RAGDOLLLAYOUT_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// RagdollLayout: compile time bone and joint tables for the ragdoll archetypes we know
+// up front (the zombie). Skeletons built from a layout use the fixed size, unrolled
+// update loops. Data driven skeletons (cooked files) keep using the dynamic path.
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include "../Ragdolls/RagdollCookedFormat.h"
+
+//The tables are static const arrays of plain records, so the compiler lays them out as
+//constant data. (Our compiler has no constexpr, this is the closest we get.)
+//The records are the same ones the cooked files use, so both paths share the loading code.
+template<UINT Bones, UINT Joints>
+struct RagdollLayout
+{
+	static_assert(Bones > 0, "A ragdoll needs at least one bone");
+	static_assert(Joints + 1 == Bones, "For n bones we need n-1 joints");
+
+	static const UINT AmountOfBones = Bones;
+	static const UINT AmountOfJoints = Joints;
+
+	//Defined per archetype in RagdollLayout.cpp
+	static const RagdollBoneRecord BoneTable[Bones];
+	static const RagdollJointRecord JointTable[Joints];
+};
+
+//Mesh bones that are not simulated in a reduced layout move rigidly with the bone they
+//hang from, so they get the bone transform of that driver
+struct RagdollFollowerRecord
+{
+	char follower[RAGDOLL_MAX_BONE_NAME]; //Mesh bone without a body in this layout
+	char driver[RAGDOLL_MAX_BONE_NAME]; //Bone of the layout it moves with
+};
+
+//The zombie archetype, used by every enemy
+typedef RagdollLayout<11, 10> HumanoidLayout;
+template<> const RagdollBoneRecord HumanoidLayout::BoneTable[HumanoidLayout::AmountOfBones];
+template<> const RagdollJointRecord HumanoidLayout::JointTable[HumanoidLayout::AmountOfJoints];
+
+//Its LOD tiers: torso and upper limbs, and torso only
+typedef RagdollLayout<6, 5> HumanoidReducedLayout;
+template<> const RagdollBoneRecord HumanoidReducedLayout::BoneTable[HumanoidReducedLayout::AmountOfBones];
+template<> const RagdollJointRecord HumanoidReducedLayout::JointTable[HumanoidReducedLayout::AmountOfJoints];
+const UINT HUMANOID_REDUCED_FOLLOWERS = HumanoidLayout::AmountOfBones - HumanoidReducedLayout::AmountOfBones;
+extern const RagdollFollowerRecord HumanoidReducedFollowerTable[HUMANOID_REDUCED_FOLLOWERS];
+
+typedef RagdollLayout<3, 2> HumanoidMinimalLayout;
+template<> const RagdollBoneRecord HumanoidMinimalLayout::BoneTable[HumanoidMinimalLayout::AmountOfBones];
+template<> const RagdollJointRecord HumanoidMinimalLayout::JointTable[HumanoidMinimalLayout::AmountOfJoints];
+const UINT HUMANOID_MINIMAL_FOLLOWERS = HumanoidLayout::AmountOfBones - HumanoidMinimalLayout::AmountOfBones;
+extern const RagdollFollowerRecord HumanoidMinimalFollowerTable[HUMANOID_MINIMAL_FOLLOWERS];
+#endif
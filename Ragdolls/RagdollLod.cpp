@@ -0,0 +1,57 @@
+//--------------------------------------------------------------------------------------
+// Physics LOD tiers of the ragdolls: the settings of every tier and the choice of
+// tier by distance and importance
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "RagdollLod.h"
+
+namespace
+{
+	//{solverIterations, contactReports, minimumDistance}
+	RagdollLodSettings g_LodSettings[RagdollLod::LodCount] =
+	{
+		{4, true, 0.0f}, //Full: 11 bodies, the PhysX default iterations
+		{3, true, 60.0f}, //Reduced: 6 bodies
+		{2, false, 100.0f} //Minimal: 3 bodies
+	};
+
+	float g_fHysteresis = 5.0f;
+}
+
+const RagdollLodSettings& RagdollLodPolicy::GetSettings(RagdollLod lod)
+{
+	return g_LodSettings[lod];
+}
+
+void RagdollLodPolicy::SetSettings(RagdollLod lod, const RagdollLodSettings& settings)
+{
+	g_LodSettings[lod] = settings;
+}
+
+void RagdollLodPolicy::SetHysteresis(float distance)
+{
+	g_fHysteresis = distance;
+}
+
+RagdollLod RagdollLodPolicy::Select(float distance, bool isImportant, RagdollLod currentLod)
+{
+	if(isImportant)
+		return RagdollLod::LodFull;
+
+	//Lowest tier we are far enough for
+	int lod = RagdollLod::LodFull;
+	for(int i = RagdollLod::LodCount - 1; i > RagdollLod::LodFull; --i)
+	{
+		//Only the tiers below the current one need the extra distance
+		float minimumDistance = g_LodSettings[i].minimumDistance;
+		if(i > currentLod)
+			minimumDistance += g_fHysteresis;
+
+		if(distance >= minimumDistance)
+		{
+			lod = i;
+			break;
+		}
+	}
+	return (RagdollLod)lod;
+}
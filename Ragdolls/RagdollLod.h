@@ -0,0 +1,30 @@
+#ifndef RAGDOLLLOD_H_INCLUDED_
+#define RAGDOLLLOD_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// Physics LOD tiers of the ragdolls: the settings of every tier and the choice of
+// tier by distance and importance
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include "../Ragdolls/RagdollHelper.h"
+
+struct RagdollLodSettings
+{
+	UINT solverIterations; //Solver iterations of every actor of the ragdoll
+	bool contactReports; //If false the actors don't send contact reports at all
+	float minimumDistance; //The tier is used from this distance (to the camera) on
+};
+
+namespace RagdollLodPolicy
+{
+	const RagdollLodSettings& GetSettings(RagdollLod lod);
+	void SetSettings(RagdollLod lod, const RagdollLodSettings& settings);
+
+	//Picks the tier for a ragdoll at this distance. Important ragdolls (held by the player,
+	//showcased) always get the full tier. To go down a tier the ragdoll has to be the
+	//hysteresis further than the distance of that tier, so it doesn't flicker on the border.
+	RagdollLod Select(float distance, bool isImportant, RagdollLod currentLod);
+	void SetHysteresis(float distance);
+}
+#endif
@@ -0,0 +1,542 @@
+//--------------------------------------------------------------------------------------
+// Batched affine transform kernels used by the ragdoll update loops in OverlordEngine
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "RagdollMath.h"
+#include "../Ragdolls/RagdollLayout.h"
+#include <cmath>
+
+//Select the widest kernel set the compiler allows us to use
+#if !defined(RAGDOLL_MATH_SCALAR)
+	#if defined(__AVX__)
+		#define RAGDOLL_MATH_AVX
+		#define RAGDOLL_MATH_SSE
+	#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) || defined(__SSE__)
+		#define RAGDOLL_MATH_SSE
+	#endif
+#endif
+
+//Widest batch of bones one kernel call handles
+#if defined(RAGDOLL_MATH_AVX)
+	#define RAGDOLL_MATH_MAX_WIDTH 8
+#elif defined(RAGDOLL_MATH_SSE)
+	#define RAGDOLL_MATH_MAX_WIDTH 4
+#else
+	#define RAGDOLL_MATH_MAX_WIDTH 1
+#endif
+
+#if defined(RAGDOLL_MATH_SSE)
+	#include <xmmintrin.h>
+#endif
+#if defined(RAGDOLL_MATH_AVX)
+	#include <immintrin.h>
+#endif
+
+namespace
+{
+	//---------------------------------------------------------
+	//Scalar reference kernel. Same order of operations as the SIMD kernels.
+	inline void MultiplyAffineScalar(float* pOut, const float* pA, const float* pB)
+	{
+		float result[16];
+		for(int r=0; r < 4; ++r)
+		{
+			const float a0 = pA[r*4], a1 = pA[r*4+1], a2 = pA[r*4+2];
+			for(int c=0; c < 3; ++c)
+			{
+				float value = a0 * pB[c] + a1 * pB[4+c] + a2 * pB[8+c];
+				if(r == 3)
+					value += pB[12+c];
+				result[r*4+c] = value;
+			}
+			result[r*4+3] = (r == 3) ? 1.0f : 0.0f;
+		}
+		for(int i=0; i < 16; ++i)
+			pOut[i] = result[i];
+	}
+
+	inline const float* Elements(const D3DXMATRIX& mat) {return &mat._11;}
+	inline float* Elements(D3DXMATRIX& mat) {return &mat._11;}
+
+	//---------------------------------------------------------
+	//Rotation part of a pose to a quaternion (x, y, z, w) and back
+	inline void RotationToQuaternion(const D3DXMATRIX& mat, float* q)
+	{
+		const float trace = mat._11 + mat._22 + mat._33;
+		if(trace > 0.0f)
+		{
+			const float s = sqrtf(trace + 1.0f) * 2.0f;
+			q[3] = 0.25f * s;
+			q[0] = (mat._32 - mat._23) / s;
+			q[1] = (mat._13 - mat._31) / s;
+			q[2] = (mat._21 - mat._12) / s;
+		}
+		else if(mat._11 > mat._22 && mat._11 > mat._33)
+		{
+			const float s = sqrtf(1.0f + mat._11 - mat._22 - mat._33) * 2.0f;
+			q[3] = (mat._32 - mat._23) / s;
+			q[0] = 0.25f * s;
+			q[1] = (mat._12 + mat._21) / s;
+			q[2] = (mat._13 + mat._31) / s;
+		}
+		else if(mat._22 > mat._33)
+		{
+			const float s = sqrtf(1.0f + mat._22 - mat._11 - mat._33) * 2.0f;
+			q[3] = (mat._13 - mat._31) / s;
+			q[0] = (mat._12 + mat._21) / s;
+			q[1] = 0.25f * s;
+			q[2] = (mat._23 + mat._32) / s;
+		}
+		else
+		{
+			const float s = sqrtf(1.0f + mat._33 - mat._11 - mat._22) * 2.0f;
+			q[3] = (mat._21 - mat._12) / s;
+			q[0] = (mat._13 + mat._31) / s;
+			q[1] = (mat._23 + mat._32) / s;
+			q[2] = 0.25f * s;
+		}
+	}
+
+	inline void QuaternionToRotation(const float* q, D3DXMATRIX& mat)
+	{
+		const float x = q[0], y = q[1], z = q[2], w = q[3];
+		mat._11 = 1.0f - 2.0f * (y*y + z*z); mat._12 = 2.0f * (x*y - z*w); mat._13 = 2.0f * (x*z + y*w); mat._14 = 0.0f;
+		mat._21 = 2.0f * (x*y + z*w); mat._22 = 1.0f - 2.0f * (x*x + z*z); mat._23 = 2.0f * (y*z - x*w); mat._24 = 0.0f;
+		mat._31 = 2.0f * (x*z - y*w); mat._32 = 2.0f * (y*z + x*w); mat._33 = 1.0f - 2.0f * (x*x + y*y); mat._34 = 0.0f;
+	}
+
+#if defined(RAGDOLL_MATH_SSE)
+	//---------------------------------------------------------
+	//An affine transform for a batch of bones. Every register holds the same element
+	//of the matrices of 4 (SSE) or 8 (AVX) bones, one bone per lane.
+	//m[row][column], the last column is always 0,0,0,1 and is not stored.
+	template<typename Reg>
+	struct AffineBatch
+	{
+		Reg m[4][3];
+	};
+
+	inline __m128 Add(__m128 a, __m128 b) {return _mm_add_ps(a, b);}
+	inline __m128 Mul(__m128 a, __m128 b) {return _mm_mul_ps(a, b);}
+	inline void Splat(__m128& out, float value) {out = _mm_set1_ps(value);}
+#if defined(RAGDOLL_MATH_AVX)
+	inline __m256 Add(__m256 a, __m256 b) {return _mm256_add_ps(a, b);}
+	inline __m256 Mul(__m256 a, __m256 b) {return _mm256_mul_ps(a, b);}
+	inline void Splat(__m256& out, float value) {out = _mm256_set1_ps(value);}
+#endif
+
+	//out = a * b for all bones in the batch
+	template<typename Reg>
+	inline void Multiply(AffineBatch<Reg>& out, const AffineBatch<Reg>& a, const AffineBatch<Reg>& b)
+	{
+		for(int r=0; r < 4; ++r)
+		{
+			for(int c=0; c < 3; ++c)
+			{
+				out.m[r][c] = Add(Add(Mul(a.m[r][0], b.m[0][c]), Mul(a.m[r][1], b.m[1][c])), Mul(a.m[r][2], b.m[2][c]));
+			}
+		}
+		//Translation row
+		for(int c=0; c < 3; ++c)
+			out.m[3][c] = Add(out.m[3][c], b.m[3][c]);
+	}
+
+	//Same matrix in every lane (world transforms)
+	template<typename Reg>
+	inline void Broadcast(AffineBatch<Reg>& out, const D3DXMATRIX& mat)
+	{
+		for(int r=0; r < 4; ++r)
+			for(int c=0; c < 3; ++c)
+				Splat(out.m[r][c], mat.m[r][c]);
+	}
+
+	//Loads 4 matrices and transposes them so every register holds one element of all 4
+	inline void Load(AffineBatch<__m128>& out, const D3DXMATRIX* const* ppMats)
+	{
+		for(int r=0; r < 4; ++r)
+		{
+			__m128 x = _mm_loadu_ps(Elements(*ppMats[0]) + r*4);
+			__m128 y = _mm_loadu_ps(Elements(*ppMats[1]) + r*4);
+			__m128 z = _mm_loadu_ps(Elements(*ppMats[2]) + r*4);
+			__m128 w = _mm_loadu_ps(Elements(*ppMats[3]) + r*4);
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			out.m[r][0] = x;
+			out.m[r][1] = y;
+			out.m[r][2] = z;
+		}
+	}
+
+	//Transposes back and stores 4 consecutive matrices
+	inline void Store(D3DXMATRIX* pOut, const AffineBatch<__m128>& in)
+	{
+		for(int r=0; r < 4; ++r)
+		{
+			__m128 x = in.m[r][0];
+			__m128 y = in.m[r][1];
+			__m128 z = in.m[r][2];
+			__m128 w = (r == 3) ? _mm_set1_ps(1.0f) : _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			_mm_storeu_ps(Elements(pOut[0]) + r*4, x);
+			_mm_storeu_ps(Elements(pOut[1]) + r*4, y);
+			_mm_storeu_ps(Elements(pOut[2]) + r*4, z);
+			_mm_storeu_ps(Elements(pOut[3]) + r*4, w);
+		}
+	}
+#endif
+
+#if defined(RAGDOLL_MATH_AVX)
+	inline __m256 LoadPair(const D3DXMATRIX& low, const D3DXMATRIX& high, int row)
+	{
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(Elements(low) + row*4)),
+			_mm_loadu_ps(Elements(high) + row*4), 1);
+	}
+
+	//Transposes the 4x4 blocks in both 128 bit halves at the same time
+	inline void Transpose8(__m256& x, __m256& y, __m256& z, __m256& w)
+	{
+		__m256 t0 = _mm256_unpacklo_ps(x, y);
+		__m256 t1 = _mm256_unpackhi_ps(x, y);
+		__m256 t2 = _mm256_unpacklo_ps(z, w);
+		__m256 t3 = _mm256_unpackhi_ps(z, w);
+		x = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1,0,1,0));
+		y = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3,2,3,2));
+		z = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1,0,1,0));
+		w = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3,2,3,2));
+	}
+
+	//Bones 0-3 end up in the low half, bones 4-7 in the high half
+	inline void Load(AffineBatch<__m256>& out, const D3DXMATRIX* const* ppMats)
+	{
+		for(int r=0; r < 4; ++r)
+		{
+			__m256 x = LoadPair(*ppMats[0], *ppMats[4], r);
+			__m256 y = LoadPair(*ppMats[1], *ppMats[5], r);
+			__m256 z = LoadPair(*ppMats[2], *ppMats[6], r);
+			__m256 w = LoadPair(*ppMats[3], *ppMats[7], r);
+			Transpose8(x, y, z, w);
+			out.m[r][0] = x;
+			out.m[r][1] = y;
+			out.m[r][2] = z;
+		}
+	}
+
+	inline void Store(D3DXMATRIX* pOut, const AffineBatch<__m256>& in)
+	{
+		for(int r=0; r < 4; ++r)
+		{
+			__m256 x = in.m[r][0];
+			__m256 y = in.m[r][1];
+			__m256 z = in.m[r][2];
+			__m256 w = (r == 3) ? _mm256_set1_ps(1.0f) : _mm256_setzero_ps();
+			Transpose8(x, y, z, w);
+			__m256 rows[4] = {x, y, z, w};
+			for(int i=0; i < 4; ++i)
+			{
+				_mm_storeu_ps(Elements(pOut[i]) + r*4, _mm256_castps256_ps128(rows[i]));
+				_mm_storeu_ps(Elements(pOut[i+4]) + r*4, _mm256_extractf128_ps(rows[i], 1));
+			}
+		}
+	}
+#endif
+
+#if defined(RAGDOLL_MATH_SSE)
+	//---------------------------------------------------------
+	//A single batch of Width bones, starting at bone i
+	template<typename Reg, UINT Width>
+	inline void LeechBatch(const D3DXMATRIX* pOffsets, const D3DXMATRIX* pKeyTransforms, const int* pBoneIndices,
+		const AffineBatch<Reg>& world, D3DXMATRIX* pOut, UINT i)
+	{
+		const D3DXMATRIX* ppOffsets[Width];
+		const D3DXMATRIX* ppKeys[Width];
+		for(UINT b=0; b < Width; ++b)
+		{
+			ppOffsets[b] = &pOffsets[i+b];
+			ppKeys[b] = &pKeyTransforms[pBoneIndices[i+b]];
+		}
+
+		AffineBatch<Reg> offsets, keys, offsetKeys, result;
+		Load(offsets, ppOffsets);
+		Load(keys, ppKeys);
+		Multiply(offsetKeys, offsets, keys);
+		Multiply(result, offsetKeys, world);
+		Store(&pOut[i], result);
+	}
+
+	template<typename Reg, UINT Width>
+	inline void SeedBatch(const D3DXMATRIX* pInvOffsets, const D3DXMATRIX* pActorPoses,
+		const AffineBatch<Reg>& invWorld, D3DXMATRIX* pOut, UINT i)
+	{
+		const D3DXMATRIX* ppInvOffsets[Width];
+		const D3DXMATRIX* ppActors[Width];
+		for(UINT b=0; b < Width; ++b)
+		{
+			ppInvOffsets[b] = &pInvOffsets[i+b];
+			ppActors[b] = &pActorPoses[i+b];
+		}
+
+		AffineBatch<Reg> invOffsets, actors, offsetActors, result;
+		Load(invOffsets, ppInvOffsets);
+		Load(actors, ppActors);
+		Multiply(offsetActors, invOffsets, actors);
+		Multiply(result, offsetActors, invWorld);
+		Store(&pOut[i], result);
+	}
+
+	//Processes as many full batches of Width bones as possible, returns the amount handled
+	template<typename Reg, UINT Width>
+	UINT LeechBatches(const D3DXMATRIX* pOffsets, const D3DXMATRIX* pKeyTransforms, const int* pBoneIndices,
+		const D3DXMATRIX& matWorld, D3DXMATRIX* pOut, UINT first, UINT count)
+	{
+		AffineBatch<Reg> world;
+		Broadcast(world, matWorld);
+
+		UINT i = first;
+		for(; i + Width <= count; i += Width)
+			LeechBatch<Reg, Width>(pOffsets, pKeyTransforms, pBoneIndices, world, pOut, i);
+		return i - first;
+	}
+
+	template<typename Reg, UINT Width>
+	UINT SeedBatches(const D3DXMATRIX* pInvOffsets, const D3DXMATRIX* pActorPoses,
+		const D3DXMATRIX& matInvWorld, D3DXMATRIX* pOut, UINT first, UINT count)
+	{
+		AffineBatch<Reg> invWorld;
+		Broadcast(invWorld, matInvWorld);
+
+		UINT i = first;
+		for(; i + Width <= count; i += Width)
+			SeedBatch<Reg, Width>(pInvOffsets, pActorPoses, invWorld, pOut, i);
+		return i - first;
+	}
+#endif
+
+	//---------------------------------------------------------
+	//Compile time unrolling for the fixed size layouts.
+	//Picks the widest batch that still fits in the remaining bones.
+	template<UINT Remaining>
+	struct BatchWidth
+	{
+		static const UINT value = (Remaining >= 8 && RAGDOLL_MATH_MAX_WIDTH >= 8) ? 8 :
+			(Remaining >= 4 && RAGDOLL_MATH_MAX_WIDTH >= 4) ? 4 : 1;
+	};
+
+	//The world transforms, broadcasted once for every batch width we use
+	struct FixedWorld
+	{
+		const D3DXMATRIX* pMatrix;
+#if defined(RAGDOLL_MATH_SSE)
+		AffineBatch<__m128> batch4;
+#endif
+#if defined(RAGDOLL_MATH_AVX)
+		AffineBatch<__m256> batch8;
+#endif
+		explicit FixedWorld(const D3DXMATRIX& matWorld):
+			pMatrix(&matWorld)
+		{
+#if defined(RAGDOLL_MATH_SSE)
+			Broadcast(batch4, matWorld);
+#endif
+#if defined(RAGDOLL_MATH_AVX)
+			Broadcast(batch8, matWorld);
+#endif
+		}
+	};
+
+	template<UINT Width> struct FixedStep;
+
+	template<>
+	struct FixedStep<1>
+	{
+		static void Leech(const D3DXMATRIX* pOffsets, const D3DXMATRIX* pKeyTransforms, const int* pBoneIndices,
+			const FixedWorld& world, D3DXMATRIX* pOut, UINT i)
+		{
+			D3DXMATRIX offsetKey;
+			MultiplyAffineScalar(Elements(offsetKey), Elements(pOffsets[i]), Elements(pKeyTransforms[pBoneIndices[i]]));
+			MultiplyAffineScalar(Elements(pOut[i]), Elements(offsetKey), Elements(*world.pMatrix));
+		}
+		static void Seed(const D3DXMATRIX* pInvOffsets, const D3DXMATRIX* pActorPoses,
+			const FixedWorld& invWorld, D3DXMATRIX* pOut, UINT i)
+		{
+			D3DXMATRIX offsetActor;
+			MultiplyAffineScalar(Elements(offsetActor), Elements(pInvOffsets[i]), Elements(pActorPoses[i]));
+			MultiplyAffineScalar(Elements(pOut[i]), Elements(offsetActor), Elements(*invWorld.pMatrix));
+		}
+	};
+
+#if defined(RAGDOLL_MATH_SSE)
+	template<>
+	struct FixedStep<4>
+	{
+		static void Leech(const D3DXMATRIX* pOffsets, const D3DXMATRIX* pKeyTransforms, const int* pBoneIndices,
+			const FixedWorld& world, D3DXMATRIX* pOut, UINT i)
+		{
+			LeechBatch<__m128, 4>(pOffsets, pKeyTransforms, pBoneIndices, world.batch4, pOut, i);
+		}
+		static void Seed(const D3DXMATRIX* pInvOffsets, const D3DXMATRIX* pActorPoses,
+			const FixedWorld& invWorld, D3DXMATRIX* pOut, UINT i)
+		{
+			SeedBatch<__m128, 4>(pInvOffsets, pActorPoses, invWorld.batch4, pOut, i);
+		}
+	};
+#endif
+
+#if defined(RAGDOLL_MATH_AVX)
+	template<>
+	struct FixedStep<8>
+	{
+		static void Leech(const D3DXMATRIX* pOffsets, const D3DXMATRIX* pKeyTransforms, const int* pBoneIndices,
+			const FixedWorld& world, D3DXMATRIX* pOut, UINT i)
+		{
+			LeechBatch<__m256, 8>(pOffsets, pKeyTransforms, pBoneIndices, world.batch8, pOut, i);
+		}
+		static void Seed(const D3DXMATRIX* pInvOffsets, const D3DXMATRIX* pActorPoses,
+			const FixedWorld& invWorld, D3DXMATRIX* pOut, UINT i)
+		{
+			SeedBatch<__m256, 8>(pInvOffsets, pActorPoses, invWorld.batch8, pOut, i);
+		}
+	};
+#endif
+
+	//Runs the step for bone First and recurses for the rest, ends when First reaches Count
+	template<UINT First, UINT Count, bool Done = (First >= Count)>
+	struct FixedLoop
+	{
+		static const UINT Width = BatchWidth<Count - First>::value;
+
+		static void Leech(const D3DXMATRIX* pOffsets, const D3DXMATRIX* pKeyTransforms, const int* pBoneIndices,
+			const FixedWorld& world, D3DXMATRIX* pOut)
+		{
+			FixedStep<Width>::Leech(pOffsets, pKeyTransforms, pBoneIndices, world, pOut, First);
+			FixedLoop<First + Width, Count>::Leech(pOffsets, pKeyTransforms, pBoneIndices, world, pOut);
+		}
+		static void Seed(const D3DXMATRIX* pInvOffsets, const D3DXMATRIX* pActorPoses,
+			const FixedWorld& invWorld, D3DXMATRIX* pOut)
+		{
+			FixedStep<Width>::Seed(pInvOffsets, pActorPoses, invWorld, pOut, First);
+			FixedLoop<First + Width, Count>::Seed(pInvOffsets, pActorPoses, invWorld, pOut);
+		}
+	};
+
+	template<UINT First, UINT Count>
+	struct FixedLoop<First, Count, true>
+	{
+		static void Leech(const D3DXMATRIX*, const D3DXMATRIX*, const int*, const FixedWorld&, D3DXMATRIX*) {}
+		static void Seed(const D3DXMATRIX*, const D3DXMATRIX*, const FixedWorld&, D3DXMATRIX*) {}
+	};
+}
+
+void RagdollMath::MultiplyAffine(D3DXMATRIX& out, const D3DXMATRIX& a, const D3DXMATRIX& b)
+{
+	MultiplyAffineScalar(Elements(out), Elements(a), Elements(b));
+}
+
+void RagdollMath::LeechTransforms(const D3DXMATRIX* pOffsets, const D3DXMATRIX* pKeyTransforms, const int* pBoneIndices,
+	const D3DXMATRIX& matWorld, D3DXMATRIX* pOut, UINT count)
+{
+	UINT i = 0;
+#if defined(RAGDOLL_MATH_AVX)
+	i += LeechBatches<__m256, 8>(pOffsets, pKeyTransforms, pBoneIndices, matWorld, pOut, i, count);
+#endif
+#if defined(RAGDOLL_MATH_SSE)
+	i += LeechBatches<__m128, 4>(pOffsets, pKeyTransforms, pBoneIndices, matWorld, pOut, i, count);
+#endif
+
+	//Remaining bones
+	for(; i < count; ++i)
+	{
+		D3DXMATRIX offsetKey;
+		MultiplyAffine(offsetKey, pOffsets[i], pKeyTransforms[pBoneIndices[i]]);
+		MultiplyAffine(pOut[i], offsetKey, matWorld);
+	}
+}
+
+void RagdollMath::SeedTransforms(const D3DXMATRIX* pInvOffsets, const D3DXMATRIX* pActorPoses,
+	const D3DXMATRIX& matInvWorld, D3DXMATRIX* pOut, UINT count)
+{
+	UINT i = 0;
+#if defined(RAGDOLL_MATH_AVX)
+	i += SeedBatches<__m256, 8>(pInvOffsets, pActorPoses, matInvWorld, pOut, i, count);
+#endif
+#if defined(RAGDOLL_MATH_SSE)
+	i += SeedBatches<__m128, 4>(pInvOffsets, pActorPoses, matInvWorld, pOut, i, count);
+#endif
+
+	//Remaining bones
+	for(; i < count; ++i)
+	{
+		D3DXMATRIX offsetActor;
+		MultiplyAffine(offsetActor, pInvOffsets[i], pActorPoses[i]);
+		MultiplyAffine(pOut[i], offsetActor, matInvWorld);
+	}
+}
+
+template<UINT Count>
+void RagdollMath::LeechTransformsFixed(const D3DXMATRIX* pOffsets, const D3DXMATRIX* pKeyTransforms, const int* pBoneIndices,
+	const D3DXMATRIX& matWorld, D3DXMATRIX* pOut)
+{
+	FixedWorld world(matWorld);
+	FixedLoop<0, Count>::Leech(pOffsets, pKeyTransforms, pBoneIndices, world, pOut);
+}
+
+template<UINT Count>
+void RagdollMath::SeedTransformsFixed(const D3DXMATRIX* pInvOffsets, const D3DXMATRIX* pActorPoses,
+	const D3DXMATRIX& matInvWorld, D3DXMATRIX* pOut)
+{
+	FixedWorld invWorld(matInvWorld);
+	FixedLoop<0, Count>::Seed(pInvOffsets, pActorPoses, invWorld, pOut);
+}
+
+//The known layouts
+template void RagdollMath::LeechTransformsFixed<HumanoidLayout::AmountOfBones>(const D3DXMATRIX*, const D3DXMATRIX*,
+	const int*, const D3DXMATRIX&, D3DXMATRIX*);
+template void RagdollMath::SeedTransformsFixed<HumanoidLayout::AmountOfBones>(const D3DXMATRIX*, const D3DXMATRIX*,
+	const D3DXMATRIX&, D3DXMATRIX*);
+template void RagdollMath::LeechTransformsFixed<HumanoidReducedLayout::AmountOfBones>(const D3DXMATRIX*, const D3DXMATRIX*,
+	const int*, const D3DXMATRIX&, D3DXMATRIX*);
+template void RagdollMath::SeedTransformsFixed<HumanoidReducedLayout::AmountOfBones>(const D3DXMATRIX*, const D3DXMATRIX*,
+	const D3DXMATRIX&, D3DXMATRIX*);
+template void RagdollMath::LeechTransformsFixed<HumanoidMinimalLayout::AmountOfBones>(const D3DXMATRIX*, const D3DXMATRIX*,
+	const int*, const D3DXMATRIX&, D3DXMATRIX*);
+template void RagdollMath::SeedTransformsFixed<HumanoidMinimalLayout::AmountOfBones>(const D3DXMATRIX*, const D3DXMATRIX*,
+	const D3DXMATRIX&, D3DXMATRIX*);
+
+void RagdollMath::InterpolatePoses(const D3DXMATRIX* pFrom, const D3DXMATRIX* pTo, float t, D3DXMATRIX* pOut, UINT count)
+{
+	for(UINT i=0; i < count; ++i)
+	{
+		float qFrom[4], qTo[4], q[4];
+		RotationToQuaternion(pFrom[i], qFrom);
+		RotationToQuaternion(pTo[i], qTo);
+
+		//q and -q are the same rotation, take the one on the short side
+		float dot = qFrom[0]*qTo[0] + qFrom[1]*qTo[1] + qFrom[2]*qTo[2] + qFrom[3]*qTo[3];
+		const float sign = (dot < 0.0f) ? -1.0f : 1.0f;
+		float lengthSq = 0.0f;
+		for(int j=0; j < 4; ++j)
+		{
+			q[j] = qFrom[j] + t * (sign * qTo[j] - qFrom[j]);
+			lengthSq += q[j] * q[j];
+		}
+		const float invLength = 1.0f / sqrtf(lengthSq);
+		for(int j=0; j < 4; ++j)
+			q[j] *= invLength;
+
+		D3DXMATRIX& out = pOut[i];
+		QuaternionToRotation(q, out);
+		out._41 = pFrom[i]._41 + t * (pTo[i]._41 - pFrom[i]._41);
+		out._42 = pFrom[i]._42 + t * (pTo[i]._42 - pFrom[i]._42);
+		out._43 = pFrom[i]._43 + t * (pTo[i]._43 - pFrom[i]._43);
+		out._44 = 1.0f;
+	}
+}
+
+const TCHAR* RagdollMath::GetKernelName()
+{
+#if defined(RAGDOLL_MATH_AVX)
+	return _T("AVX (8 bones)");
+#elif defined(RAGDOLL_MATH_SSE)
+	return _T("SSE (4 bones)");
+#else
+	return _T("Scalar");
+#endif
+}
\ No newline at end of file
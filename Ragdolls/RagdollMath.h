@@ -0,0 +1,44 @@
+#ifndef RAGDOLLMATH_H_INCLUDED_
+#define RAGDOLLMATH_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// Batched affine transform kernels used by the ragdoll update loops in OverlordEngine
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include "../../../OverlordEngine/Helpers/D3DUtil.h"
+
+//All matrices passed to these kernels must be affine (D3DX layout: last column 0,0,0,1).
+//Only the 3x4 part is multiplied, the last column of the result is always 0,0,0,1.
+//The SSE/AVX kernels process 4/8 bones per iteration. Define RAGDOLL_MATH_SCALAR to
+//force the scalar reference kernels. Results match D3DXMatrixMultiply within float tolerance.
+namespace RagdollMath
+{
+	//out = a * b
+	void MultiplyAffine(D3DXMATRIX& out, const D3DXMATRIX& a, const D3DXMATRIX& b);
+
+	//LeechMode: out[i] = offsets[i] * keyTransforms[boneIndices[i]] * world
+	void LeechTransforms(const D3DXMATRIX* pOffsets, const D3DXMATRIX* pKeyTransforms, const int* pBoneIndices,
+		const D3DXMATRIX& matWorld, D3DXMATRIX* pOut, UINT count);
+
+	//SeedMode: out[i] = invOffsets[i] * actorPoses[i] * invWorld
+	void SeedTransforms(const D3DXMATRIX* pInvOffsets, const D3DXMATRIX* pActorPoses,
+		const D3DXMATRIX& matInvWorld, D3DXMATRIX* pOut, UINT count);
+
+	//Same kernels for a count known at compile time (RagdollLayout). The batches and the
+	//scalar tail are unrolled. Instantiated in RagdollMath.cpp for the known layouts.
+	template<UINT Count>
+	void LeechTransformsFixed(const D3DXMATRIX* pOffsets, const D3DXMATRIX* pKeyTransforms, const int* pBoneIndices,
+		const D3DXMATRIX& matWorld, D3DXMATRIX* pOut);
+	template<UINT Count>
+	void SeedTransformsFixed(const D3DXMATRIX* pInvOffsets, const D3DXMATRIX* pActorPoses,
+		const D3DXMATRIX& matInvWorld, D3DXMATRIX* pOut);
+
+	//Rigid poses (rotation and translation, no scale) at t between from (0) and to (1).
+	//Rotations are blended as quaternions (normalized lerp, over the shortest arc).
+	void InterpolatePoses(const D3DXMATRIX* pFrom, const D3DXMATRIX* pTo, float t, D3DXMATRIX* pOut, UINT count);
+
+	//Name of the kernel set that was compiled in (for logging)
+	const TCHAR* GetKernelName();
+}
+#endif
\ No newline at end of file
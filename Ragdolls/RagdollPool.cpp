@@ -0,0 +1,200 @@
+//--------------------------------------------------------------------------------------
+// RagdollPool: keeps built ragdolls (actors) parked in the scene and hands
+// them out again, so spawning and removing enemies doesn't create or release PhysX objects
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "RagdollPool.h"
+#include "../Ragdolls/PhysxSkeleton.h"
+#include "../Ragdolls/PhysicsAnimator.h"
+#include "../Ragdolls/RagdollProxy.h"
+#include "../Ragdolls/RagdollReleaseQueue.h"
+#include "../Ragdolls/RagdollPosePipeline.h"
+
+RagdollPool* RagdollPool::m_pInstance = nullptr;
+
+RagdollPool::RagdollPool(void):
+	m_iMaxParked(64),
+	m_iAmountCreated(0),
+	m_iAmountReused(0)
+{
+	//Far below the level, the actors don't collide anyway
+	D3DXMatrixTranslation(&m_matParkTransform, 0.0f, -1000.0f, 0.0f);
+}
+
+RagdollPool::~RagdollPool(void)
+{
+	Clear();
+}
+
+RagdollPool* RagdollPool::GetInstance()
+{
+	if(m_pInstance == nullptr)
+		m_pInstance = new RagdollPool();
+	return m_pInstance;
+}
+
+void RagdollPool::DestroyInstance()
+{
+	SafeDelete(m_pInstance);
+}
+
+PhysxSkeleton* RagdollPool::Acquire(NxScene* pScene, PhysicsGroup group,
+	const std::shared_ptr<const RagdollDefinition>& pDefinition, PhysicsAnimator* pOwner)
+{
+	if(pScene == nullptr || !pDefinition)
+		return nullptr;
+
+	PhysxSkeleton* pSkeleton = nullptr;
+
+	PoolKey key = {pScene, pDefinition.get(), group};
+	auto it = m_ParkedSkeletons.find(key);
+	if(it != m_ParkedSkeletons.end() && !it->second.empty())
+	{
+		pSkeleton = it->second.back();
+		it->second.pop_back();
+		++m_iAmountReused;
+	}
+	else
+	{
+		pSkeleton = CreateSkeleton(pScene, group, pDefinition);
+	}
+
+	pSkeleton->Attach(pOwner);
+	return pSkeleton;
+}
+
+void RagdollPool::Release(PhysxSkeleton* pSkeleton)
+{
+	if(pSkeleton == nullptr)
+		return;
+
+	PoolKey key = {pSkeleton->GetPhysicsScene(), pSkeleton->GetDefinition(), pSkeleton->GetPhysicsGroup()};
+	vector<PhysxSkeleton*>& vParked = m_ParkedSkeletons[key];
+	if(vParked.size() >= m_iMaxParked)
+	{
+		SafeDelete(pSkeleton);
+		return;
+	}
+
+	pSkeleton->Park(m_matParkTransform);
+	vParked.push_back(pSkeleton);
+}
+
+RagdollProxy* RagdollPool::AcquireProxy(NxScene* pScene, PhysicsGroup group,
+	const std::shared_ptr<const RagdollDefinition>& pDefinition, PhysicsAnimator* pOwner)
+{
+	if(pScene == nullptr || !pDefinition)
+		return nullptr;
+
+	RagdollProxy* pProxy = nullptr;
+
+	PoolKey key = {pScene, pDefinition.get(), group};
+	auto it = m_ParkedProxies.find(key);
+	if(it != m_ParkedProxies.end() && !it->second.empty())
+	{
+		pProxy = it->second.back();
+		it->second.pop_back();
+	}
+	else
+	{
+		//The proxy is sized on the definition, so it's pooled per definition as well
+		pProxy = new RagdollProxy(pScene, group);
+		pProxy->Initiliaze(*pDefinition);
+	}
+
+	pProxy->Attach(pOwner);
+	return pProxy;
+}
+
+void RagdollPool::ReleaseProxy(RagdollProxy* pProxy, const RagdollDefinition* pDefinition)
+{
+	if(pProxy == nullptr)
+		return;
+
+	PoolKey key = {pProxy->GetPhysicsScene(), pDefinition, pProxy->GetPhysicsGroup()};
+	vector<RagdollProxy*>& vParked = m_ParkedProxies[key];
+	if(vParked.size() >= m_iMaxParked)
+	{
+		SafeDelete(pProxy);
+		return;
+	}
+
+	pProxy->Park(m_matParkTransform);
+	vParked.push_back(pProxy);
+}
+
+void RagdollPool::Prewarm(NxScene* pScene, PhysicsGroup group,
+	const std::shared_ptr<const RagdollDefinition>& pDefinition, UINT amount)
+{
+	if(pScene == nullptr || !pDefinition)
+		return;
+
+	PoolKey key = {pScene, pDefinition.get(), group};
+	vector<PhysxSkeleton*>& vParked = m_ParkedSkeletons[key];
+	while(vParked.size() < amount && vParked.size() < m_iMaxParked)
+	{
+		PhysxSkeleton* pSkeleton = CreateSkeleton(pScene, group, pDefinition);
+		pSkeleton->Park(m_matParkTransform);
+		vParked.push_back(pSkeleton);
+	}
+
+	//Every skeleton in LeechState stands in the scene as a proxy
+	vector<RagdollProxy*>& vParkedProxies = m_ParkedProxies[key];
+	while(vParkedProxies.size() < amount && vParkedProxies.size() < m_iMaxParked)
+	{
+		RagdollProxy* pProxy = new RagdollProxy(pScene, group);
+		pProxy->Initiliaze(*pDefinition);
+		pProxy->Park(m_matParkTransform);
+		vParkedProxies.push_back(pProxy);
+	}
+}
+
+void RagdollPool::Clear(NxScene* pScene)
+{
+	for(auto it = m_ParkedSkeletons.begin(); it != m_ParkedSkeletons.end();)
+	{
+		if(pScene != nullptr && it->first.pScene != pScene)
+		{
+			++it;
+			continue;
+		}
+
+		for(auto pSkeleton : it->second)
+			SafeDelete(pSkeleton);
+		it = m_ParkedSkeletons.erase(it);
+	}
+	for(auto it = m_ParkedProxies.begin(); it != m_ParkedProxies.end();)
+	{
+		if(pScene != nullptr && it->first.pScene != pScene)
+		{
+			++it;
+			continue;
+		}
+
+		for(auto pProxy : it->second)
+			SafeDelete(pProxy);
+		it = m_ParkedProxies.erase(it);
+	}
+
+	//The scene is about to go, so its objects can't wait for the release queue
+	RagdollReleaseQueue::GetInstance()->ReleaseAll(pScene);
+}
+
+UINT RagdollPool::GetAmountParked() const
+{
+	UINT amount = 0;
+	for(const auto& parked : m_ParkedSkeletons)
+		amount += parked.second.size();
+	return amount;
+}
+
+PhysxSkeleton* RagdollPool::CreateSkeleton(NxScene* pScene, PhysicsGroup group,
+	const std::shared_ptr<const RagdollDefinition>& pDefinition)
+{
+	//Build skeleton, pure instantiation of the definition. The joints are created lazily.
+	ASSERT(!RagdollPosePipeline::GetInstance()->IsEnabled(), _T("RagdollPool: creating actors while PhysX simulates, prewarm the pool before enabling the RagdollPosePipeline!"));
+	PhysxSkeleton* pSkeleton = new PhysxSkeleton(pScene, group, nullptr, pDefinition);
+	pSkeleton->Initiliaze();
+	++m_iAmountCreated;
+	return pSkeleton;
+}
@@ -0,0 +1,96 @@
+#ifndef RAGDOLLPOOL_H_INCLUDED_
+#define RAGDOLLPOOL_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// RagdollPool: keeps built ragdolls (actors) parked in the scene and hands
+// them out again, so spawning and removing enemies doesn't create or release PhysX objects
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include "../../../OverlordEngine/Helpers/D3DUtil.h"
+#include "../../../OverlordEngine/OverlordComponents.h"
+#include "../Ragdolls/RagdollDefinition.h"
+#include <vector>
+#include <map>
+#include <memory>
+
+class PhysxSkeleton;
+class PhysicsAnimator;
+class RagdollProxy;
+
+class RagdollPool final
+{
+public:
+	static RagdollPool* GetInstance();
+	//Destroy before the RagdollReleaseQueue, the parked skeletons are released through it
+	static void DestroyInstance();
+
+	//METHODS
+	//Returns a skeleton attached to the owner, in LeechState. Reuses a parked one if there is one.
+	PhysxSkeleton* Acquire(NxScene* pScene, PhysicsGroup group,
+		const std::shared_ptr<const RagdollDefinition>& pDefinition, PhysicsAnimator* pOwner);
+	//Takes the skeleton back and parks it. If the pool is full, the skeleton is deleted.
+	void Release(PhysxSkeleton* pSkeleton);
+	//Same for the single actor proxies standing in for a skeleton in LeechState
+	RagdollProxy* AcquireProxy(NxScene* pScene, PhysicsGroup group,
+		const std::shared_ptr<const RagdollDefinition>& pDefinition, PhysicsAnimator* pOwner);
+	void ReleaseProxy(RagdollProxy* pProxy, const RagdollDefinition* pDefinition);
+	//Builds parked skeletons and proxies up front (eg. before a wave starts)
+	void Prewarm(NxScene* pScene, PhysicsGroup group,
+		const std::shared_ptr<const RagdollDefinition>& pDefinition, UINT amount);
+	//Deletes the parked skeletons and proxies of a scene (all scenes if nullptr) and flushes the
+	//release queue for it. Has to be called before the PhysX scene is released!
+	void Clear(NxScene* pScene = nullptr);
+
+	//SETTERS
+	//Maximum amount of parked skeletons per scene, group and definition
+	void SetMaxParked(UINT amount) {m_iMaxParked = amount;};
+	//Where parked ragdolls wait, far away from the playfield
+	void SetParkTransform(const D3DXMATRIX& parkTransform) {m_matParkTransform = parkTransform;};
+
+	//GETTERS
+	UINT GetAmountParked() const;
+	UINT GetAmountCreated() const {return m_iAmountCreated;};
+	UINT GetAmountReused() const {return m_iAmountReused;};
+
+private:
+	RagdollPool(void);
+	~RagdollPool(void);
+
+	static RagdollPool* m_pInstance;
+
+	//Parked skeletons can only be reused in the same scene and group, with the same definition
+	struct PoolKey
+	{
+		NxScene* pScene;
+		const RagdollDefinition* pDefinition;
+		PhysicsGroup group;
+
+		bool operator<(const PoolKey& other) const
+		{
+			if(pScene != other.pScene)
+				return pScene < other.pScene;
+			if(pDefinition != other.pDefinition)
+				return pDefinition < other.pDefinition;
+			return group < other.group;
+		}
+	};
+	std::map<PoolKey, vector<PhysxSkeleton*>> m_ParkedSkeletons;
+	std::map<PoolKey, vector<RagdollProxy*>> m_ParkedProxies;
+
+	D3DXMATRIX m_matParkTransform;
+	UINT m_iMaxParked;
+	UINT m_iAmountCreated, m_iAmountReused;
+
+	//METHODS
+	PhysxSkeleton* CreateSkeleton(NxScene* pScene, PhysicsGroup group,
+		const std::shared_ptr<const RagdollDefinition>& pDefinition);
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	RagdollPool(const RagdollPool& yRef);
+	RagdollPool& operator=(const RagdollPool& yRef);
+};
+#endif
@@ -0,0 +1,137 @@
+//--------------------------------------------------------------------------------------
+// RagdollPosePipeline: reads the state of all simulating ragdolls once, right after
+// fetchResults, into a double-buffered snapshot per skeleton. The game and render code
+// use those snapshots while PhysX simulates the next step (one frame of latency).
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "RagdollPosePipeline.h"
+#include "PhysxSkeleton.h"
+#include "RagdollCommandBuffer.h"
+#include <algorithm>
+#include <cmath>
+
+RagdollPosePipeline* RagdollPosePipeline::m_pInstance = nullptr;
+
+RagdollPosePipeline::RagdollPosePipeline(void):
+	m_bEnabled(false),
+	m_bStartedRecording(false),
+	m_bEnabledByFixedStep(false),
+	m_iCapturedLastFrame(0),
+	m_fFixedStep(0.0f),
+	m_iMaxSteps(4),
+	m_fAccumulator(0.0f),
+	m_fInterpolation(1.0f)
+{
+}
+
+RagdollPosePipeline::~RagdollPosePipeline(void)
+{
+}
+
+RagdollPosePipeline* RagdollPosePipeline::GetInstance()
+{
+	if(m_pInstance == nullptr)
+		m_pInstance = new RagdollPosePipeline();
+	return m_pInstance;
+}
+
+void RagdollPosePipeline::DestroyInstance()
+{
+	SafeDelete(m_pInstance);
+}
+
+void RagdollPosePipeline::Register(PhysxSkeleton* pSkeleton)
+{
+	if(pSkeleton != nullptr)
+		m_vpSkeletons.push_back(pSkeleton);
+}
+
+void RagdollPosePipeline::Unregister(PhysxSkeleton* pSkeleton)
+{
+	auto it = std::find(m_vpSkeletons.begin(), m_vpSkeletons.end(), pSkeleton);
+	if(it == m_vpSkeletons.end())
+		return;
+
+	//Order doesn't matter, every skeleton only captures its own actors
+	*it = m_vpSkeletons.back();
+	m_vpSkeletons.pop_back();
+}
+
+void RagdollPosePipeline::SetEnabled(bool enabled)
+{
+	if(enabled == m_bEnabled)
+		return;
+
+	RagdollCommandBuffer* pCommands = RagdollCommandBuffer::GetInstance();
+	if(enabled)
+	{
+		m_bStartedRecording = !pCommands->IsRecording();
+		pCommands->SetRecording(true);
+	}
+	else
+	{
+		if(m_bStartedRecording)
+			pCommands->SetRecording(false);
+		m_bStartedRecording = false;
+		m_bEnabledByFixedStep = false;
+		//Interpolating needs the snapshots
+		m_fFixedStep = 0.0f;
+		m_fAccumulator = 0.0f;
+		m_fInterpolation = 1.0f;
+	}
+	m_bEnabled = enabled;
+}
+
+void RagdollPosePipeline::SetFixedStep(float step, UINT maxSteps)
+{
+	m_fFixedStep = (step > 0.0f) ? step : 0.0f;
+	m_iMaxSteps = (maxSteps > 0) ? maxSteps : 1;
+	m_fAccumulator = 0.0f;
+	m_fInterpolation = 1.0f;
+	if(m_fFixedStep > 0.0f && !m_bEnabled)
+	{
+		SetEnabled(true);
+		m_bEnabledByFixedStep = true;
+	}
+	else if(m_fFixedStep <= 0.0f && m_bEnabledByFixedStep)
+	{
+		SetEnabled(false);
+	}
+}
+
+UINT RagdollPosePipeline::Advance(float deltaTime)
+{
+	if(m_fFixedStep <= 0.0f)
+	{
+		m_fInterpolation = 1.0f;
+		return 1;
+	}
+
+	m_fAccumulator += deltaTime;
+	UINT steps = (UINT)(m_fAccumulator / m_fFixedStep);
+	//A long frame (loading, a breakpoint) would make the next frames even longer, drop the rest
+	if(steps > m_iMaxSteps)
+	{
+		steps = m_iMaxSteps;
+		m_fAccumulator = fmodf(m_fAccumulator, m_fFixedStep) + steps * m_fFixedStep;
+	}
+	m_fAccumulator -= steps * m_fFixedStep;
+	m_fInterpolation = m_fAccumulator / m_fFixedStep;
+	return steps;
+}
+
+void RagdollPosePipeline::Capture()
+{
+	m_iCapturedLastFrame = 0;
+	if(!m_bEnabled)
+		return;
+
+	for(auto pSkeleton : m_vpSkeletons)
+	{
+		if(!pSkeleton->NeedsCapture())
+			continue;
+
+		pSkeleton->CapturePoses();
+		++m_iCapturedLastFrame;
+	}
+}
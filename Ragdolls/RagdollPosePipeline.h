@@ -0,0 +1,78 @@
+#ifndef RAGDOLLPOSEPIPELINE_H_INCLUDED_
+#define RAGDOLLPOSEPIPELINE_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// RagdollPosePipeline: reads the state of all simulating ragdolls once, right after
+// fetchResults, into a double-buffered snapshot per skeleton. The game and render code
+// use those snapshots while PhysX simulates the next step (one frame of latency).
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include <vector>
+
+class PhysxSkeleton;
+
+class RagdollPosePipeline final
+{
+public:
+	static RagdollPosePipeline* GetInstance();
+	static void DestroyInstance();
+
+	//METHODS
+	//Every PhysxSkeleton registers itself for its lifetime
+	void Register(PhysxSkeleton* pSkeleton);
+	void Unregister(PhysxSkeleton* pSkeleton);
+	//Captures the skeletons that are simulating (SeedState or an active region). Game thread only,
+	//after fetchResults and RagdollCommandBuffer::Flush (so our own writes are in), before the next simulate.
+	//With a fixed step: after every step, so the last two snapshots are the last two steps.
+	void Capture();
+	//Fixed step accumulator: the amount of steps of GetFixedStep the scene has to simulate this frame
+	//(can be 0). Without a fixed step it is always 1 step of the frame time.
+	UINT Advance(float deltaTime);
+
+	//SETTERS
+	//Disabled (default), the skeletons read PhysX themselves after the step.
+	//Enabling also turns on the recording of the RagdollCommandBuffer: nothing may write to PhysX while it simulates.
+	//Disabling undoes that (unless the recording was on already) and turns off the fixed step.
+	//Creating actors can't be recorded: prewarm the RagdollPool (and so its proxies) and don't bake
+	//ragdolls while enabled. Those paths assert on it.
+	void SetEnabled(bool enabled);
+	//Runs the physics at a fixed rate (eg. 1/30), independent of the frame rate. The seed poses are
+	//blended between the last two steps. At most maxSteps per frame, the time above that is dropped.
+	//0 turns it off. A fixed step enables the pipeline, it needs the snapshots. Turning it off disables
+	//the pipeline again, if it was the fixed step that enabled it.
+	void SetFixedStep(float step, UINT maxSteps = 4);
+
+	//GETTERS
+	bool IsEnabled() const {return m_bEnabled;};
+	float GetFixedStep() const {return m_fFixedStep;};
+	//Where the frame is between the last two steps (0 = the one before, 1 = the last one)
+	float GetInterpolation() const {return m_fInterpolation;};
+	//Amount of skeletons read by the last Capture
+	UINT GetCapturedLastFrame() const {return m_iCapturedLastFrame;};
+
+private:
+	RagdollPosePipeline(void);
+	~RagdollPosePipeline(void);
+
+	static RagdollPosePipeline* m_pInstance;
+
+	bool m_bEnabled;
+	bool m_bStartedRecording; //We turned on the recording of the RagdollCommandBuffer, so we turn it off
+	bool m_bEnabledByFixedStep;
+	std::vector<PhysxSkeleton*> m_vpSkeletons;
+	UINT m_iCapturedLastFrame;
+
+	float m_fFixedStep; //0: one step per frame
+	UINT m_iMaxSteps;
+	float m_fAccumulator; //Frame time not simulated yet
+	float m_fInterpolation;
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	RagdollPosePipeline(const RagdollPosePipeline& yRef);
+	RagdollPosePipeline& operator=(const RagdollPosePipeline& yRef);
+};
+#endif
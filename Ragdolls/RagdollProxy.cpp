@@ -0,0 +1,110 @@
+//--------------------------------------------------------------------------------------
+// RagdollProxy: a single kinematic capsule standing in for the ragdoll of an animated
+// enemy, so a walking enemy doesn't need the actors of a full PhysxSkeleton
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "RagdollProxy.h"
+#include "../Ragdolls/RagdollReleaseQueue.h"
+#include "../Ragdolls/RagdollCommandBuffer.h"
+#include "../Ragdolls/RagdollPosePipeline.h"
+#include "../../../OverlordEngine/Managers/PhysicsManager.h"
+#include "../../../OverlordEngine/Diagnostics/Logger.h"
+
+//Proxy shapes are recognised by this name (compared by address, not by content)
+static const char* const RAGDOLL_PROXY_SHAPE_NAME = "RagdollProxy";
+
+RagdollProxy::RagdollProxy(NxScene* pScene, PhysicsGroup group):
+	m_pActor(nullptr),
+	m_bPushedPoseValid(false),
+	m_pPhysicsScene(pScene),
+	m_nxPhysxGroup(group),
+	m_pOwnerPhysicsAnimator(nullptr)
+{
+	D3DXMatrixIdentity(&m_matPushedPose);
+}
+
+RagdollProxy::~RagdollProxy(void)
+{
+	RagdollCommandBuffer::GetInstance()->Cancel(this);
+	if(m_pActor)
+	{
+		m_pActor->getShapes()[0]->userData = nullptr;
+		RagdollReleaseQueue::GetInstance()->QueueRelease(m_pPhysicsScene, m_pActor);
+	}
+	m_pActor = nullptr;
+}
+
+void RagdollProxy::Initiliaze(const RagdollDefinition& definition)
+{
+	if(m_pPhysicsScene == nullptr || definition.GetAmountOfBones() == 0)
+		return;
+
+	//Size the capsule on the bind pose: from the lowest to the highest actor, as wide as the thickest bone
+	const D3DXMATRIX* pTotalOffsets = definition.GetTotalOffsets();
+	float lowest = pTotalOffsets[0]._42, highest = pTotalOffsets[0]._42;
+	float thickest = 0.0f;
+	for(UINT slot=0; slot < definition.GetAmountOfBones(); ++slot)
+	{
+		lowest = min(lowest, pTotalOffsets[slot]._42);
+		highest = max(highest, pTotalOffsets[slot]._42 + definition.GetBoneRecord(slot).height);
+		thickest = max(thickest, definition.GetBoneRecord(slot).radius);
+	}
+
+	NxCapsuleShapeDesc capsuleDesc;
+	capsuleDesc.setToDefault();
+	capsuleDesc.radius = 2.0f * thickest;
+	capsuleDesc.height = max(highest - lowest - 2.0f * capsuleDesc.radius, 0.0f);
+	capsuleDesc.localPose.t = NxVec3(0, 0.5f * (lowest + highest), 0);
+	capsuleDesc.group = m_nxPhysxGroup;
+	capsuleDesc.name = RAGDOLL_PROXY_SHAPE_NAME;
+	capsuleDesc.userData = this;
+
+	//Kinematic and without collision, like the actors of a skeleton in LeechState.
+	//Only queries (picking, force fields) see it.
+	NxBodyDesc bodyDesc;
+	bodyDesc.setToDefault();
+	bodyDesc.flags |= NX_BF_KINEMATIC;
+
+	NxActorDesc actorDesc;
+	actorDesc.shapes.pushBack(&capsuleDesc);
+	actorDesc.body = &bodyDesc;
+	actorDesc.density = 10.0f;
+	actorDesc.flags |= NX_AF_DISABLE_COLLISION;
+
+	ASSERT(!RagdollPosePipeline::GetInstance()->IsEnabled(), _T("RagdollProxy: creating an actor while PhysX simulates, prewarm the pool before enabling the RagdollPosePipeline!"));
+	m_pActor = m_pPhysicsScene->createActor(actorDesc);
+	if(!m_pActor)
+	{
+		Logger::Log(_T("RagdollProxy: Error creating actor"), LogLevel::Error);
+		return;
+	}
+	m_pActor->userData = nullptr;
+	m_bPushedPoseValid = false;
+}
+
+void RagdollProxy::SetGlobalPose(const D3DXMATRIX& matWorldPose)
+{
+	if(m_pActor == nullptr)
+		return;
+	if(m_bPushedPoseValid && memcmp(&matWorldPose, &m_matPushedPose, sizeof(D3DXMATRIX)) == 0)
+		return;
+
+	NxMat34 nPos;
+	PhysicsManager::GetInstance()->DMatToNMat(nPos, matWorldPose);
+	RagdollCommandBuffer::GetInstance()->SetGlobalPose(m_pActor, nPos, this);
+	m_matPushedPose = matWorldPose;
+	m_bPushedPoseValid = true;
+}
+
+void RagdollProxy::Park(const D3DXMATRIX& parkTransform)
+{
+	Attach(nullptr);
+	SetGlobalPose(parkTransform);
+}
+
+RagdollProxy* RagdollProxy::GetProxyOfShape(NxShape* pShape)
+{
+	if(pShape == nullptr || pShape->getName() != RAGDOLL_PROXY_SHAPE_NAME)
+		return nullptr;
+	return reinterpret_cast<RagdollProxy*>(pShape->userData);
+}
@@ -0,0 +1,60 @@
+#ifndef RAGDOLLPROXY_H_INCLUDED_
+#define RAGDOLLPROXY_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// RagdollProxy: a single kinematic capsule standing in for the ragdoll of an animated
+// enemy, so a walking enemy doesn't need the actors of a full PhysxSkeleton
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include "../../../OverlordEngine/Helpers/D3DUtil.h"
+#include "../../../OverlordEngine/OverlordComponents.h"
+#include "../Ragdolls/RagdollDefinition.h"
+
+class PhysicsAnimator;
+
+class RagdollProxy final
+{
+public:
+	RagdollProxy(NxScene* pScene, PhysicsGroup group);
+	~RagdollProxy(void);
+
+	//METHODS
+	//Creates the actor, sized to cover the bind pose of the definition
+	void Initiliaze(const RagdollDefinition& definition);
+	//Moves the proxy, nothing is written to PhysX if the pose didn't change
+	void SetGlobalPose(const D3DXMATRIX& matWorldPose);
+
+	//Pooling (see RagdollPool), same as the PhysxSkeleton
+	void Attach(PhysicsAnimator* ownerPhysicsAnimator) {m_pOwnerPhysicsAnimator = ownerPhysicsAnimator;};
+	void Park(const D3DXMATRIX& parkTransform);
+	bool IsParked() const {return m_pOwnerPhysicsAnimator == nullptr;};
+
+	//GETTERS
+	//The actor has no userData (code reading it expects a PhysxBone),
+	//the shape's userData points to this proxy instead.
+	NxActor* GetActor() const {return m_pActor;};
+	NxScene* GetPhysicsScene() const {return m_pPhysicsScene;};
+	PhysicsGroup GetPhysicsGroup() const {return m_nxPhysxGroup;};
+	PhysicsAnimator* GetOwnerPhysxAnimator() const {return m_pOwnerPhysicsAnimator;};
+	//Returns the proxy a shape belongs to, nullptr if it isn't a proxy shape
+	static RagdollProxy* GetProxyOfShape(NxShape* pShape);
+
+private:
+	//DATAMEMBERS
+	NxActor* m_pActor;
+	D3DXMATRIX m_matPushedPose; //Last pose written to PhysX
+	bool m_bPushedPoseValid;
+
+	NxScene* m_pPhysicsScene;
+	PhysicsGroup m_nxPhysxGroup;
+	PhysicsAnimator* m_pOwnerPhysicsAnimator;
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	RagdollProxy(const RagdollProxy& yRef);
+	RagdollProxy& operator=(const RagdollProxy& yRef);
+};
+#endif
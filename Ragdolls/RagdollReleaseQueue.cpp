@@ -0,0 +1,124 @@
+//--------------------------------------------------------------------------------------
+// RagdollReleaseQueue: releases the PhysX actors and joints of destroyed ragdolls over
+// several frames, under a budget, instead of all at once when the ragdolls are deleted
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "RagdollReleaseQueue.h"
+#include "RagdollCommandBuffer.h"
+
+RagdollReleaseQueue* RagdollReleaseQueue::m_pInstance = nullptr;
+
+RagdollReleaseQueue::RagdollReleaseQueue(void):
+	m_iMaxReleasesPerFrame(32),
+	m_fMaxMillisecondsPerFrame(0.5f),
+	m_iPeakQueueDepth(0),
+	m_iReleasedLastFrame(0)
+{
+	QueryPerformanceFrequency(&m_Frequency);
+}
+
+RagdollReleaseQueue::~RagdollReleaseQueue(void)
+{
+	ReleaseAll();
+}
+
+RagdollReleaseQueue* RagdollReleaseQueue::GetInstance()
+{
+	if(m_pInstance == nullptr)
+		m_pInstance = new RagdollReleaseQueue();
+	return m_pInstance;
+}
+
+void RagdollReleaseQueue::DestroyInstance()
+{
+	SafeDelete(m_pInstance);
+}
+
+void RagdollReleaseQueue::QueueRelease(NxScene* pScene, NxActor* pActor)
+{
+	if(pScene == nullptr || pActor == nullptr)
+		return;
+
+	//The owner is gone, make sure nothing reaches it through the actor anymore.
+	//No owner on the commands: the one destroying the actor cancels its own, not these.
+	pActor->userData = nullptr;
+	RagdollCommandBuffer* pCommands = RagdollCommandBuffer::GetInstance();
+	pCommands->RaiseActorFlag(pActor, NX_AF_DISABLE_COLLISION);
+	if(pActor->isDynamic())
+		pCommands->RaiseBodyFlag(pActor, NX_BF_KINEMATIC);
+
+	ReleaseEntry entry = {pScene, pActor, nullptr};
+	Push(entry);
+}
+
+void RagdollReleaseQueue::QueueRelease(NxScene* pScene, NxJoint* pJoint)
+{
+	if(pScene == nullptr || pJoint == nullptr)
+		return;
+
+	pJoint->userData = nullptr;
+
+	ReleaseEntry entry = {pScene, nullptr, pJoint};
+	Push(entry);
+}
+
+void RagdollReleaseQueue::Update()
+{
+	m_iReleasedLastFrame = 0;
+	if(m_Queue.empty())
+		return;
+
+	LARGE_INTEGER start, now;
+	QueryPerformanceCounter(&start);
+
+	while(!m_Queue.empty())
+	{
+		if(m_iMaxReleasesPerFrame > 0 && m_iReleasedLastFrame >= m_iMaxReleasesPerFrame)
+			break;
+
+		//Always release at least one, so the queue keeps moving
+		if(m_fMaxMillisecondsPerFrame > 0.0f && m_iReleasedLastFrame > 0)
+		{
+			QueryPerformanceCounter(&now);
+			float elapsed = (float)(now.QuadPart - start.QuadPart) * 1000.0f / (float)m_Frequency.QuadPart;
+			if(elapsed >= m_fMaxMillisecondsPerFrame)
+				break;
+		}
+
+		Release(m_Queue.front());
+		m_Queue.pop_front();
+		++m_iReleasedLastFrame;
+	}
+}
+
+void RagdollReleaseQueue::ReleaseAll(NxScene* pScene)
+{
+	//The recorded writes still point at these actors
+	RagdollCommandBuffer::GetInstance()->Flush();
+
+	//Keep the order, joints are queued before their actors
+	std::deque<ReleaseEntry> remaining;
+	for(const auto& entry : m_Queue)
+	{
+		if(pScene == nullptr || entry.pScene == pScene)
+			Release(entry);
+		else
+			remaining.push_back(entry);
+	}
+	m_Queue.swap(remaining);
+}
+
+void RagdollReleaseQueue::Push(const ReleaseEntry& entry)
+{
+	m_Queue.push_back(entry);
+	if(m_Queue.size() > m_iPeakQueueDepth)
+		m_iPeakQueueDepth = m_Queue.size();
+}
+
+void RagdollReleaseQueue::Release(const ReleaseEntry& entry)
+{
+	if(entry.pJoint != nullptr)
+		entry.pScene->releaseJoint(*entry.pJoint);
+	else if(entry.pActor != nullptr)
+		entry.pScene->releaseActor(*entry.pActor);
+}
@@ -0,0 +1,81 @@
+#ifndef RAGDOLLRELEASEQUEUE_H_INCLUDED_
+#define RAGDOLLRELEASEQUEUE_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// RagdollReleaseQueue: releases the PhysX actors and joints of destroyed ragdolls over
+// several frames, under a budget, instead of all at once when the ragdolls are deleted
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include "../../../OverlordEngine/OverlordComponents.h"
+#include <deque>
+
+class RagdollReleaseQueue final
+{
+public:
+	static RagdollReleaseQueue* GetInstance();
+	static void DestroyInstance();
+
+	//METHODS
+	//Queue an object for release. The object is taken out of the simulation (kinematic, no collision,
+	//through the RagdollCommandBuffer so at the next flush when it is recording) and released later by Update.
+	//Joints of an actor have to be queued before the actor itself.
+	void QueueRelease(NxScene* pScene, NxActor* pActor);
+	void QueueRelease(NxScene* pScene, NxJoint* pJoint);
+	//Releases queued objects until the budget is used. Call once per frame, outside
+	//the simulate window (after fetchResults, before the next simulate).
+	void Update();
+	//Releases everything queued for the scene right now (all scenes if nullptr).
+	//Flushes the RagdollCommandBuffer first, so no recorded write is left for a released actor.
+	//Has to be called before the PhysX scene is released!
+	void ReleaseAll(NxScene* pScene = nullptr);
+
+	//SETTERS
+	//Maximum amount of objects and time released per Update. 0 == no limit.
+	void SetBudget(UINT maxReleasesPerFrame, float maxMillisecondsPerFrame)
+	{
+		m_iMaxReleasesPerFrame = maxReleasesPerFrame;
+		m_fMaxMillisecondsPerFrame = maxMillisecondsPerFrame;
+	};
+
+	//GETTERS
+	//Amount of objects still waiting to be released
+	UINT GetQueueDepth() const {return m_Queue.size();};
+	//Highest queue depth since the last ResetStatistics
+	UINT GetPeakQueueDepth() const {return m_iPeakQueueDepth;};
+	//Amount of objects released in the last Update
+	UINT GetReleasedLastFrame() const {return m_iReleasedLastFrame;};
+	void ResetStatistics() {m_iPeakQueueDepth = m_Queue.size(); m_iReleasedLastFrame = 0;};
+
+private:
+	RagdollReleaseQueue(void);
+	~RagdollReleaseQueue(void);
+
+	static RagdollReleaseQueue* m_pInstance;
+
+	struct ReleaseEntry
+	{
+		NxScene* pScene;
+		NxActor* pActor; //Either an actor
+		NxJoint* pJoint; //Or a joint
+	};
+	std::deque<ReleaseEntry> m_Queue;
+
+	UINT m_iMaxReleasesPerFrame;
+	float m_fMaxMillisecondsPerFrame;
+	UINT m_iPeakQueueDepth;
+	UINT m_iReleasedLastFrame;
+	LARGE_INTEGER m_Frequency;
+
+	//METHODS
+	void Push(const ReleaseEntry& entry);
+	static void Release(const ReleaseEntry& entry);
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	RagdollReleaseQueue(const RagdollReleaseQueue& yRef);
+	RagdollReleaseQueue& operator=(const RagdollReleaseQueue& yRef);
+};
+#endif
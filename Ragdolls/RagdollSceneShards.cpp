@@ -0,0 +1,379 @@
+//--------------------------------------------------------------------------------------
+// RagdollSceneShards: spreads the ragdolls over several PhysX scenes by region, so they
+// are simulated on more than one core. Every extra scene has a copy of the static level,
+// ragdolls move to the scene of the region they are in.
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "RagdollSceneShards.h"
+#include "PhysicsAnimator.h"
+#include "RagdollPool.h"
+#include "../../../OverlordEngine/Diagnostics/Logger.h"
+#include <algorithm>
+#include <memory>
+#include <cmath>
+
+RagdollSceneShards* RagdollSceneShards::m_pInstance = nullptr;
+
+RagdollSceneShards::RagdollSceneShards(void):
+	m_fRegionSize(50.0f),
+	m_fMigrationMargin(2.0f),
+	m_iMaxMigrations(4),
+	m_iNextAnimator(0),
+	m_iMigratedLastFrame(0)
+{
+}
+
+RagdollSceneShards::~RagdollSceneShards(void)
+{
+	ASSERT(!IsActive(), _T("RagdollSceneShards: destroyed without Shutdown, the extra scenes are leaked!"));
+}
+
+RagdollSceneShards* RagdollSceneShards::GetInstance()
+{
+	if(m_pInstance == nullptr)
+		m_pInstance = new RagdollSceneShards();
+	return m_pInstance;
+}
+
+void RagdollSceneShards::DestroyInstance()
+{
+	SafeDelete(m_pInstance);
+}
+
+bool RagdollSceneShards::Initialize(NxScene* pMainScene, UINT amountScenes, float regionSize)
+{
+	Shutdown();
+	if(pMainScene == nullptr || amountScenes < 2 || regionSize <= 0.0f)
+	{
+		Logger::Log(_T("RagdollSceneShards: Needs a main scene, at least 2 scenes and a region size"), LogLevel::Warning);
+		return false;
+	}
+
+	m_fRegionSize = regionSize;
+	m_vpScenes.push_back(pMainScene);
+
+	NxSceneDesc sceneDesc;
+	pMainScene->saveToDesc(sceneDesc);
+	//The statics are copied over, a ground plane would be there twice
+	sceneDesc.groundPlane = false;
+	//Every scene steps on a thread of its own
+	sceneDesc.flags |= NX_SF_SIMULATE_SEPARATE_THREAD;
+
+	NxPhysicsSDK& physicsSDK = pMainScene->getPhysicsSDK();
+	for(UINT i=1; i < amountScenes; ++i)
+	{
+		NxScene* pScene = physicsSDK.createScene(sceneDesc);
+		if(pScene == nullptr)
+		{
+			Logger::Log(_T("RagdollSceneShards: Error creating a scene, going on with less"), LogLevel::Warning);
+			break;
+		}
+		CopySceneSettings(pMainScene, pScene);
+		m_vpScenes.push_back(pScene);
+	}
+
+	if(!IsActive())
+	{
+		m_vpScenes.clear();
+		return false;
+	}
+
+	ReplicateStatics();
+	return true;
+}
+
+void RagdollSceneShards::CopySceneSettings(NxScene* pSource, NxScene* pDestination)
+{
+	//Shapes refer to their material by index, so the indices have to match
+	const NxMaterialIndex highestMaterial = pSource->getHighestMaterialIndex();
+	for(NxMaterialIndex i=0; i <= highestMaterial; ++i)
+	{
+		NxMaterialDesc materialDesc;
+		pSource->getMaterialFromIndex(i)->saveToDesc(materialDesc);
+		if(i == 0)
+		{
+			pDestination->getMaterialFromIndex(0)->loadFromDesc(materialDesc);
+			continue;
+		}
+
+		NxMaterial* pMaterial = pDestination->createMaterial(materialDesc);
+		if(pMaterial == nullptr || pMaterial->getMaterialIndex() != i)
+			Logger::Log(_T("RagdollSceneShards: Material indices of the scenes don't match"), LogLevel::Warning);
+	}
+
+	for(NxCollisionGroup group1=0; group1 < 32; ++group1)
+	{
+		for(NxCollisionGroup group2=group1; group2 < 32; ++group2)
+			pDestination->setGroupCollisionFlag(group1, group2, pSource->getGroupCollisionFlag(group1, group2));
+	}
+
+	NxFilterOp op0, op1, op2;
+	pSource->getFilterOps(op0, op1, op2);
+	pDestination->setFilterOps(op0, op1, op2);
+	pDestination->setFilterBool(pSource->getFilterBool());
+	pDestination->setFilterConstant0(pSource->getFilterConstant0());
+	pDestination->setFilterConstant1(pSource->getFilterConstant1());
+
+	NxReal maxTimestep;
+	NxU32 maxIterations;
+	NxTimeStepMethod method;
+	pSource->getTiming(maxTimestep, maxIterations, method);
+	pDestination->setTiming(maxTimestep, maxIterations, method);
+}
+
+void RagdollSceneShards::ReplicateStatics()
+{
+	ReleaseReplicatedStatics();
+	if(!IsActive())
+		return;
+
+	NxScene* pMainScene = m_vpScenes[0];
+	const NxU32 amountActors = pMainScene->getNbActors();
+	NxActor** ppActors = pMainScene->getActors();
+	std::vector<std::unique_ptr<NxShapeDesc>> shapeDescs;
+	for(NxU32 i=0; i < amountActors; ++i)
+	{
+		NxActor* pActor = ppActors[i];
+		//Dynamic objects stay in the main scene, a baked corpse belongs to its own scene
+		if(pActor->isDynamic() || PhysicsAnimator::IsBakedCollider(pActor))
+			continue;
+
+		//Same userData and name, so contact reports and queries see the original object
+		NxActorDesc actorDesc;
+		actorDesc.globalPose = pActor->getGlobalPose();
+		actorDesc.group = pActor->getGroup();
+		actorDesc.dominanceGroup = pActor->getDominanceGroup();
+		actorDesc.contactReportFlags = pActor->getContactReportFlags();
+		actorDesc.name = pActor->getName();
+		actorDesc.userData = pActor->userData;
+
+		shapeDescs.clear();
+		NxShape* const* ppShapes = pActor->getShapes();
+		for(NxU32 shape=0; shape < pActor->getNbShapes(); ++shape)
+		{
+			NxShapeDesc* pShapeDesc = CreateShapeDesc(ppShapes[shape]);
+			if(pShapeDesc == nullptr)
+				continue;
+			shapeDescs.push_back(std::unique_ptr<NxShapeDesc>(pShapeDesc));
+			actorDesc.shapes.pushBack(pShapeDesc);
+		}
+		if(shapeDescs.empty())
+			continue;
+
+		for(UINT scene=1; scene < m_vpScenes.size(); ++scene)
+		{
+			NxActor* pCopy = m_vpScenes[scene]->createActor(actorDesc);
+			if(pCopy != nullptr)
+				m_vpReplicatedStatics.push_back(pCopy);
+			else
+				Logger::Log(_T("RagdollSceneShards: Error copying a static actor"), LogLevel::Warning);
+		}
+	}
+}
+
+NxShapeDesc* RagdollSceneShards::CreateShapeDesc(NxShape* pShape)
+{
+	//The meshes are shared, they belong to the SDK and not to a scene
+	switch(pShape->getType())
+	{
+	case NX_SHAPE_PLANE:
+		{
+			NxPlaneShapeDesc* pDesc = new NxPlaneShapeDesc();
+			pShape->isPlane()->saveToDesc(*pDesc);
+			return pDesc;
+		}
+	case NX_SHAPE_SPHERE:
+		{
+			NxSphereShapeDesc* pDesc = new NxSphereShapeDesc();
+			pShape->isSphere()->saveToDesc(*pDesc);
+			return pDesc;
+		}
+	case NX_SHAPE_BOX:
+		{
+			NxBoxShapeDesc* pDesc = new NxBoxShapeDesc();
+			pShape->isBox()->saveToDesc(*pDesc);
+			return pDesc;
+		}
+	case NX_SHAPE_CAPSULE:
+		{
+			NxCapsuleShapeDesc* pDesc = new NxCapsuleShapeDesc();
+			pShape->isCapsule()->saveToDesc(*pDesc);
+			return pDesc;
+		}
+	case NX_SHAPE_CONVEX:
+		{
+			NxConvexShapeDesc* pDesc = new NxConvexShapeDesc();
+			pShape->isConvexMesh()->saveToDesc(*pDesc);
+			return pDesc;
+		}
+	case NX_SHAPE_MESH:
+		{
+			NxTriangleMeshShapeDesc* pDesc = new NxTriangleMeshShapeDesc();
+			pShape->isTriangleMesh()->saveToDesc(*pDesc);
+			return pDesc;
+		}
+	case NX_SHAPE_HEIGHTFIELD:
+		{
+			NxHeightFieldShapeDesc* pDesc = new NxHeightFieldShapeDesc();
+			pShape->isHeightField()->saveToDesc(*pDesc);
+			return pDesc;
+		}
+	}
+
+	Logger::Log(_T("RagdollSceneShards: Static shape type can't be copied, skipped"), LogLevel::Warning);
+	return nullptr;
+}
+
+void RagdollSceneShards::ReleaseReplicatedStatics()
+{
+	for(auto pActor : m_vpReplicatedStatics)
+		pActor->getScene().releaseActor(*pActor);
+	m_vpReplicatedStatics.clear();
+}
+
+void RagdollSceneShards::Shutdown()
+{
+	if(!IsActive())
+	{
+		m_vpScenes.clear();
+		return;
+	}
+
+	//Everybody back to the main scene
+	NxScene* pMainScene = m_vpScenes[0];
+	for(auto pAnimator : m_vpAnimators)
+	{
+		if(pAnimator->GetPhysicsScene() == pMainScene || !IsOurScene(pAnimator->GetPhysicsScene()))
+			continue;
+		pAnimator->DeactivateRegion();
+		if(!pAnimator->MoveToScene(pMainScene))
+			Logger::Log(_T("RagdollSceneShards: A ragdoll can't leave its scene, release its enemy before Shutdown!"), LogLevel::Error);
+	}
+
+	ReleaseReplicatedStatics();
+	NxPhysicsSDK& physicsSDK = pMainScene->getPhysicsSDK();
+	for(UINT i=1; i < m_vpScenes.size(); ++i)
+	{
+		//The parked skeletons and everything in the release queue of this scene go first
+		RagdollPool::GetInstance()->Clear(m_vpScenes[i]);
+		physicsSDK.releaseScene(*m_vpScenes[i]);
+	}
+	m_vpScenes.clear();
+	m_vpMainSceneRequests.clear();
+}
+
+void RagdollSceneShards::Register(PhysicsAnimator* pAnimator)
+{
+	if(pAnimator != nullptr)
+		m_vpAnimators.push_back(pAnimator);
+}
+
+void RagdollSceneShards::Unregister(PhysicsAnimator* pAnimator)
+{
+	m_vpMainSceneRequests.erase(std::remove(m_vpMainSceneRequests.begin(), m_vpMainSceneRequests.end(), pAnimator),
+		m_vpMainSceneRequests.end());
+
+	auto it = std::find(m_vpAnimators.begin(), m_vpAnimators.end(), pAnimator);
+	if(it == m_vpAnimators.end())
+		return;
+
+	//Order doesn't matter, every animator is looked at on its own
+	*it = m_vpAnimators.back();
+	m_vpAnimators.pop_back();
+}
+
+void RagdollSceneShards::RequestMainScene(PhysicsAnimator* pAnimator)
+{
+	if(pAnimator != nullptr && IsActive())
+		m_vpMainSceneRequests.push_back(pAnimator);
+}
+
+void RagdollSceneShards::Update()
+{
+	m_iMigratedLastFrame = 0;
+	if(!IsActive() || m_vpAnimators.empty())
+	{
+		m_vpMainSceneRequests.clear();
+		return;
+	}
+
+	//The requests first and not limited by the round robin: the ragdoll has to meet the force field now
+	for(auto pAnimator : m_vpMainSceneRequests)
+	{
+		NxScene* pScene = pAnimator->GetPhysicsScene();
+		if(IsOurScene(pScene) && pScene != m_vpScenes[0] && pAnimator->MoveToScene(m_vpScenes[0]))
+			++m_iMigratedLastFrame;
+	}
+
+	const UINT amountAnimators = m_vpAnimators.size();
+	if(m_iNextAnimator >= amountAnimators)
+		m_iNextAnimator = 0;
+
+	UINT checked = 0;
+	for(; checked < amountAnimators && m_iMigratedLastFrame < m_iMaxMigrations; ++checked)
+	{
+		PhysicsAnimator* pAnimator = m_vpAnimators[(m_iNextAnimator + checked) % amountAnimators];
+		NxScene* pScene = pAnimator->GetPhysicsScene();
+		if(!IsOurScene(pScene))
+			continue;
+
+		NxScene* pTargetScene = GetTargetScene(pAnimator);
+		if(pTargetScene != pScene && pAnimator->MoveToScene(pTargetScene))
+			++m_iMigratedLastFrame;
+	}
+	m_iNextAnimator = (m_iNextAnimator + checked) % amountAnimators;
+	m_vpMainSceneRequests.clear();
+}
+
+void RagdollSceneShards::Simulate(float deltaTime)
+{
+	for(UINT i=1; i < m_vpScenes.size(); ++i)
+	{
+		m_vpScenes[i]->simulate(deltaTime);
+		m_vpScenes[i]->flushStream();
+	}
+}
+
+void RagdollSceneShards::FetchResults()
+{
+	for(UINT i=1; i < m_vpScenes.size(); ++i)
+		m_vpScenes[i]->fetchResults(NX_RIGID_BODY_FINISHED, true);
+}
+
+UINT RagdollSceneShards::GetSceneIndexAt(const D3DXVECTOR3& position) const
+{
+	if(!IsActive())
+		return 0;
+
+	//Neighbouring regions go to different scenes, in diagonal bands
+	const int cellX = (int)floorf(position.x / m_fRegionSize);
+	const int cellZ = (int)floorf(position.z / m_fRegionSize);
+	const int amountScenes = (int)m_vpScenes.size();
+	int index = (cellX + cellZ) % amountScenes;
+	if(index < 0)
+		index += amountScenes;
+	return (UINT)index;
+}
+
+NxScene* RagdollSceneShards::GetTargetScene(PhysicsAnimator* pAnimator) const
+{
+	if(std::find(m_vpMainSceneRequests.begin(), m_vpMainSceneRequests.end(), pAnimator) != m_vpMainSceneRequests.end())
+		return m_vpScenes[0];
+
+	const D3DXMATRIX& matWorld = pAnimator->GetWorldTransform();
+	const D3DXVECTOR3 position(matWorld._41, matWorld._42, matWorld._43);
+
+	//Near a border we stay where we are, whatever side of it we are on
+	const float cellX = position.x / m_fRegionSize - floorf(position.x / m_fRegionSize);
+	const float cellZ = position.z / m_fRegionSize - floorf(position.z / m_fRegionSize);
+	const float margin = m_fMigrationMargin / m_fRegionSize;
+	if(cellX < margin || cellX > 1.0f - margin || cellZ < margin || cellZ > 1.0f - margin)
+		return pAnimator->GetPhysicsScene();
+
+	return m_vpScenes[GetSceneIndexAt(position)];
+}
+
+bool RagdollSceneShards::IsOurScene(NxScene* pScene) const
+{
+	return std::find(m_vpScenes.begin(), m_vpScenes.end(), pScene) != m_vpScenes.end();
+}
@@ -0,0 +1,101 @@
+#ifndef RAGDOLLSCENESHARDS_H_INCLUDED_
+#define RAGDOLLSCENESHARDS_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// RagdollSceneShards: spreads the ragdolls over several PhysX scenes by region, so they
+// are simulated on more than one core. Every extra scene has a copy of the static level,
+// ragdolls move to the scene of the region they are in.
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include "../../../OverlordEngine/Helpers/D3DUtil.h"
+#include "../../../OverlordEngine/OverlordComponents.h"
+#include <vector>
+
+class PhysicsAnimator;
+
+class RagdollSceneShards final
+{
+public:
+	static RagdollSceneShards* GetInstance();
+	//Shutdown first, the scenes are not released here
+	static void DestroyInstance();
+
+	//METHODS
+	//Creates amountScenes - 1 scenes next to the main scene, with its settings, materials and a
+	//copy of its static actors. Regions are squares of regionSize on the XZ plane, spread over
+	//all scenes (the main scene included). Returns false if no extra scene could be made.
+	bool Initialize(NxScene* pMainScene, UINT amountScenes, float regionSize);
+	//Copies the static actors of the main scene again (the level changed)
+	void ReplicateStatics();
+	//Moves all ragdolls back to the main scene and releases the others. Game thread, after
+	//RagdollCommandBuffer::Flush, before the main scene is released.
+	void Shutdown();
+
+	//Every PhysicsAnimator registers itself for its lifetime
+	void Register(PhysicsAnimator* pAnimator);
+	void Unregister(PhysicsAnimator* pAnimator);
+	//Force fields, the controllers and all other dynamic objects only live in the main scene.
+	//A ragdoll that has to meet them asks every frame, it moves there in the next Update
+	//(before the others, whatever the maximum amount of migrations).
+	void RequestMainScene(PhysicsAnimator* pAnimator);
+	//Moves the ragdolls that entered the region of another scene. Game thread, after FetchResults
+	//and before RagdollCommandBuffer::Flush (the actors are read, nothing may be simulating).
+	void Update();
+
+	//Steps the extra scenes, each on its own simulation thread. Call right after the main scene simulates,
+	//with the same time step.
+	void Simulate(float deltaTime);
+	//Waits for the extra scenes, right after the main scene fetched its results
+	void FetchResults();
+
+	//SETTERS
+	//A ragdoll only moves once it is this far inside its new region, so walking along a border doesn't bounce it
+	void SetMigrationMargin(float margin){m_fMigrationMargin = margin;};
+	//Moving a ragdoll recreates its actors, spread that over frames
+	void SetMaxMigrationsPerFrame(UINT amount){m_iMaxMigrations = amount;};
+
+	//GETTERS
+	bool IsActive() const {return m_vpScenes.size() > 1;};
+	//All scenes, the main one first. Queries looking for ragdoll actors have to go over all of them.
+	UINT GetAmountScenes() const {return m_vpScenes.size();};
+	NxScene* GetScene(UINT index) const {return m_vpScenes[index];};
+	//Scene of the region this position is in
+	UINT GetSceneIndexAt(const D3DXVECTOR3& position) const;
+	UINT GetMigratedLastFrame() const {return m_iMigratedLastFrame;};
+
+private:
+	RagdollSceneShards(void);
+	~RagdollSceneShards(void);
+
+	static RagdollSceneShards* m_pInstance;
+
+	std::vector<NxScene*> m_vpScenes; //Main scene first, it isn't ours
+	std::vector<NxActor*> m_vpReplicatedStatics; //Copies in the extra scenes
+	std::vector<PhysicsAnimator*> m_vpAnimators;
+	std::vector<PhysicsAnimator*> m_vpMainSceneRequests; //This frame only
+
+	float m_fRegionSize;
+	float m_fMigrationMargin;
+	UINT m_iMaxMigrations;
+	UINT m_iNextAnimator; //Round robin start, so the budget doesn't starve the ones at the back
+	UINT m_iMigratedLastFrame;
+
+	//METHODS
+	//The scene the ragdoll should be in, its current one while it is near a border
+	NxScene* GetTargetScene(PhysicsAnimator* pAnimator) const;
+	bool IsOurScene(NxScene* pScene) const;
+	//Materials, collision groups, filtering and timing of the main scene
+	void CopySceneSettings(NxScene* pSource, NxScene* pDestination);
+	void ReleaseReplicatedStatics();
+	//Description of a (static) shape, nullptr for types we can't copy. Caller deletes.
+	static NxShapeDesc* CreateShapeDesc(NxShape* pShape);
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	RagdollSceneShards(const RagdollSceneShards& yRef);
+	RagdollSceneShards& operator=(const RagdollSceneShards& yRef);
+};
+#endif
@@ -0,0 +1,83 @@
+//--------------------------------------------------------------------------------------
+// RagdollTransitionQueue: spreads the state changes of the ragdolls (LeechState <-> SeedState)
+// over several frames, under a budget, so a crowd changing state at once doesn't flip all
+// body flags and wake all islands in the same simulate step
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "RagdollTransitionQueue.h"
+#include "PhysicsAnimator.h"
+#include <algorithm>
+
+RagdollTransitionQueue* RagdollTransitionQueue::m_pInstance = nullptr;
+
+RagdollTransitionQueue::RagdollTransitionQueue(void):
+	m_bEnabled(false),
+	m_iMaxTransitionsPerFrame(4),
+	m_iPeakQueueDepth(0),
+	m_iTransitionsLastFrame(0)
+{
+}
+
+RagdollTransitionQueue::~RagdollTransitionQueue(void)
+{
+}
+
+RagdollTransitionQueue* RagdollTransitionQueue::GetInstance()
+{
+	if(m_pInstance == nullptr)
+		m_pInstance = new RagdollTransitionQueue();
+	return m_pInstance;
+}
+
+void RagdollTransitionQueue::DestroyInstance()
+{
+	SafeDelete(m_pInstance);
+}
+
+void RagdollTransitionQueue::Queue(PhysicsAnimator* pAnimator)
+{
+	if(pAnimator == nullptr)
+		return;
+
+	m_Queue.push_back(pAnimator);
+	if(m_Queue.size() > m_iPeakQueueDepth)
+		m_iPeakQueueDepth = m_Queue.size();
+}
+
+void RagdollTransitionQueue::SetEnabled(bool enabled)
+{
+	m_bEnabled = enabled;
+	if(m_bEnabled)
+		return;
+
+	//Nobody calls Update anymore, nothing may be left waiting
+	while(!m_Queue.empty())
+	{
+		PhysicsAnimator* pAnimator = m_Queue.front();
+		m_Queue.pop_front();
+		pAnimator->ApplyQueuedState();
+	}
+}
+
+void RagdollTransitionQueue::Remove(PhysicsAnimator* pAnimator)
+{
+	m_Queue.erase(std::remove(m_Queue.begin(), m_Queue.end(), pAnimator), m_Queue.end());
+}
+
+void RagdollTransitionQueue::Update()
+{
+	m_iTransitionsLastFrame = 0;
+
+	while(!m_Queue.empty())
+	{
+		if(m_iMaxTransitionsPerFrame > 0 && m_iTransitionsLastFrame >= m_iMaxTransitionsPerFrame)
+			break;
+
+		PhysicsAnimator* pAnimator = m_Queue.front();
+		m_Queue.pop_front();
+
+		//Requests that were taken back (or applied right away) don't use the budget
+		if(pAnimator->ApplyQueuedState())
+			++m_iTransitionsLastFrame;
+	}
+}
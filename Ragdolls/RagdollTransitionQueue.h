@@ -0,0 +1,69 @@
+#ifndef RAGDOLLTRANSITIONQUEUE_H_INCLUDED_
+#define RAGDOLLTRANSITIONQUEUE_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// RagdollTransitionQueue: spreads the state changes of the ragdolls (LeechState <-> SeedState)
+// over several frames, under a budget, so a crowd changing state at once doesn't flip all
+// body flags and wake all islands in the same simulate step
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include <deque>
+
+class PhysicsAnimator;
+
+class RagdollTransitionQueue final
+{
+public:
+	static RagdollTransitionQueue* GetInstance();
+	static void DestroyInstance();
+
+	//METHODS
+	//Queue an animator whose requested state differs from its current state.
+	//Until its turn, it stays in its current state.
+	void Queue(PhysicsAnimator* pAnimator);
+	//Takes the animator out of the queue (destroyed animators)
+	void Remove(PhysicsAnimator* pAnimator);
+	//Applies queued transitions until the budget is used, oldest first. Call once per frame,
+	//before the ragdolls are updated and outside the simulate window.
+	void Update();
+
+	//SETTERS
+	//Disabled (default), every state change is applied right away. Only enable it when the scene
+	//calls Update every frame. Disabling applies whatever is still waiting.
+	void SetEnabled(bool enabled);
+	//Maximum amount of transitions applied per Update. 0 == no limit.
+	void SetBudget(UINT maxTransitionsPerFrame) {m_iMaxTransitionsPerFrame = maxTransitionsPerFrame;};
+
+	//GETTERS
+	bool IsEnabled() const {return m_bEnabled;};
+	//Amount of animators still waiting for their transition
+	UINT GetQueueDepth() const {return m_Queue.size();};
+	//Highest queue depth since the last ResetStatistics
+	UINT GetPeakQueueDepth() const {return m_iPeakQueueDepth;};
+	//Amount of transitions applied in the last Update
+	UINT GetTransitionsLastFrame() const {return m_iTransitionsLastFrame;};
+	void ResetStatistics() {m_iPeakQueueDepth = m_Queue.size(); m_iTransitionsLastFrame = 0;};
+
+private:
+	RagdollTransitionQueue(void);
+	~RagdollTransitionQueue(void);
+
+	static RagdollTransitionQueue* m_pInstance;
+
+	std::deque<PhysicsAnimator*> m_Queue;
+
+	bool m_bEnabled;
+
+	UINT m_iMaxTransitionsPerFrame;
+	UINT m_iPeakQueueDepth;
+	UINT m_iTransitionsLastFrame;
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	RagdollTransitionQueue(const RagdollTransitionQueue& yRef);
+	RagdollTransitionQueue& operator=(const RagdollTransitionQueue& yRef);
+};
+#endif
@@ -0,0 +1,89 @@
+//--------------------------------------------------------------------------------------
+// RagdollUpdateBatch: collects the skeletons of all PhysicsAnimators during the scene update
+// and updates them together, so their pose math runs in parallel on the RagdollJobSystem
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#include "RagdollUpdateBatch.h"
+#include "PhysicsAnimator.h"
+#include "RagdollJobSystem.h"
+#include <algorithm>
+
+RagdollUpdateBatch* RagdollUpdateBatch::m_pInstance = nullptr;
+
+RagdollUpdateBatch::RagdollUpdateBatch(void):
+	m_bEnabled(false)
+{
+}
+
+RagdollUpdateBatch::~RagdollUpdateBatch(void)
+{
+}
+
+RagdollUpdateBatch* RagdollUpdateBatch::GetInstance()
+{
+	if(m_pInstance == nullptr)
+		m_pInstance = new RagdollUpdateBatch();
+	return m_pInstance;
+}
+
+void RagdollUpdateBatch::DestroyInstance()
+{
+	SafeDelete(m_pInstance);
+}
+
+void RagdollUpdateBatch::SetEnabled(bool enabled)
+{
+	//The workers are only worth their threads once there is a batch to run
+	if(enabled && !RagdollJobSystem::GetInstance()->IsStarted())
+		RagdollJobSystem::GetInstance()->Start();
+	m_bEnabled = enabled;
+}
+
+void RagdollUpdateBatch::QueueLeech(PhysicsAnimator* pAnimator)
+{
+	if(pAnimator != nullptr)
+		m_vpLeechAnimators.push_back(pAnimator);
+}
+
+void RagdollUpdateBatch::QueueSeed(PhysicsAnimator* pAnimator)
+{
+	if(pAnimator != nullptr)
+		m_vpSeedAnimators.push_back(pAnimator);
+}
+
+void RagdollUpdateBatch::Remove(PhysicsAnimator* pAnimator)
+{
+	m_vpLeechAnimators.erase(std::remove(m_vpLeechAnimators.begin(), m_vpLeechAnimators.end(), pAnimator), m_vpLeechAnimators.end());
+	m_vpSeedAnimators.erase(std::remove(m_vpSeedAnimators.begin(), m_vpSeedAnimators.end(), pAnimator), m_vpSeedAnimators.end());
+}
+
+void RagdollUpdateBatch::Update(float deltaTime)
+{
+	//The state or skeleton can have changed since the animator was queued, only take what still fits
+	m_vpSkeletons.clear();
+	for(auto pAnimator : m_vpLeechAnimators)
+	{
+		if(pAnimator->GetCurrentState() == RagdollState::LeechState && pAnimator->GetSkeleton() != nullptr)
+			m_vpSkeletons.push_back(pAnimator->GetSkeleton());
+	}
+	if(!m_vpSkeletons.empty())
+		PhysxSkeleton::UpdateLeechMode(m_vpSkeletons.data(), m_vpSkeletons.size());
+
+	m_vpSkeletons.clear();
+	for(auto pAnimator : m_vpSeedAnimators)
+	{
+		if(pAnimator->GetCurrentState() == RagdollState::SeedState && pAnimator->GetSkeleton() != nullptr)
+			m_vpSkeletons.push_back(pAnimator->GetSkeleton());
+	}
+	if(!m_vpSkeletons.empty())
+		PhysxSkeleton::UpdateSeedMode(m_vpSkeletons.data(), m_vpSkeletons.size());
+
+	//Everything that can change the state (settle events, timers) comes after the skeleton updates
+	for(UINT i=0; i < m_vpLeechAnimators.size(); ++i)
+		m_vpLeechAnimators[i]->FinishLeechUpdate(deltaTime);
+	for(UINT i=0; i < m_vpSeedAnimators.size(); ++i)
+		m_vpSeedAnimators[i]->FinishSeedUpdate(deltaTime);
+
+	m_vpLeechAnimators.clear();
+	m_vpSeedAnimators.clear();
+}
@@ -0,0 +1,57 @@
+#ifndef RAGDOLLUPDATEBATCH_H_INCLUDED_
+#define RAGDOLLUPDATEBATCH_H_INCLUDED_
+//--------------------------------------------------------------------------------------
+// RagdollUpdateBatch: collects the skeletons of all PhysicsAnimators during the scene update
+// and updates them together, so their pose math runs in parallel on the RagdollJobSystem
+// Created by Matthieu Delaere
+//--------------------------------------------------------------------------------------
+#pragma once
+#include "../../../OverlordEngine/Helpers/stdafx.h"
+#include <vector>
+
+class PhysicsAnimator;
+class PhysxSkeleton;
+
+class RagdollUpdateBatch final
+{
+public:
+	static RagdollUpdateBatch* GetInstance();
+	static void DestroyInstance();
+
+	//METHODS
+	//Queued by the PhysicsAnimators while the batch is enabled, instead of updating their skeleton
+	void QueueLeech(PhysicsAnimator* pAnimator);
+	void QueueSeed(PhysicsAnimator* pAnimator);
+	//Takes the animator out of the batch (destroyed animators)
+	void Remove(PhysicsAnimator* pAnimator);
+	//Updates all queued skeletons: PhysX reads, the math in parallel, PhysX writes, and then
+	//the settle events. Call once per frame after the scene update, before drawing.
+	void Update(float deltaTime);
+
+	//SETTERS
+	//Disabled (default), every PhysicsAnimator updates its own skeleton right away, on the game thread.
+	//Only enable it when the scene calls Update every frame. Enabling starts the RagdollJobSystem.
+	void SetEnabled(bool enabled);
+
+	//GETTERS
+	bool IsEnabled() const {return m_bEnabled;};
+
+private:
+	RagdollUpdateBatch(void);
+	~RagdollUpdateBatch(void);
+
+	static RagdollUpdateBatch* m_pInstance;
+
+	bool m_bEnabled;
+	std::vector<PhysicsAnimator*> m_vpLeechAnimators;
+	std::vector<PhysicsAnimator*> m_vpSeedAnimators;
+	std::vector<PhysxSkeleton*> m_vpSkeletons; //Reused every Update, no allocations once grown
+
+	// -------------------------
+	// Disabling default copy constructor and default
+	// assignment operator.
+	// -------------------------
+	RagdollUpdateBatch(const RagdollUpdateBatch& yRef);
+	RagdollUpdateBatch& operator=(const RagdollUpdateBatch& yRef);
+};
+#endif